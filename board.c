@@ -0,0 +1,593 @@
+#define _POSIX_C_SOURCE 200809L // For getline()
+#include "board.h"
+#include <string.h> // For strcmp(), strncmp(), strspn()
+#include <limits.h> // For INT_MAX
+
+#define BASE 10
+#define NUM_OF_TRANSITIONS 20
+#define CONFIG_DELIMITERS " \t\r\n"
+#define SIZE_KEYWORD "size"
+#define INVALID_CONFIG_MESSAGE "Error: invalid board configuration: %s\n"
+#define UNPLAYABLE_MESSAGE "Error: invalid board configuration: cell %d %s\n"
+
+/**
+ * represents the transitions by ladders and snakes in the game
+ * each tuple (x,y) represents a ladder from x to if x<y or a snake otherwise
+ */
+const int transitions[][2] = {{13, 4},
+                              {85, 17},
+                              {95, 67},
+                              {97, 58},
+                              {66, 89},
+                              {87, 31},
+                              {57, 83},
+                              {91, 25},
+                              {28, 50},
+                              {35, 11},
+                              {8,  30},
+                              {41, 62},
+                              {81, 43},
+                              {69, 32},
+                              {20, 39},
+                              {33, 70},
+                              {79, 99},
+                              {23, 76},
+                              {15, 47},
+                              {61, 14}};
+
+/**
+ * as described in board.h
+ */
+void free_board(Board *board) {
+    free(board->dice);
+    board->dice = NULL;
+    free(board->jump_to);
+    board->jump_to = NULL;
+}
+
+/**
+ * as described in board.h
+ */
+int allocate_board(Board *board, int size, int dice_max) {
+    board->size = size;
+    board->dice_max = dice_max;
+    board->dice = calloc(dice_max, sizeof(int));
+    board->jump_to = malloc(sizeof(int) * size);
+    if (board->dice == NULL || board->jump_to == NULL) {
+        free_board(board);
+        printf(ALLOCATION_ERROR_MASSAGE);
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < size; i++) {
+        board->jump_to[i] = EMPTY;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * as described in board.h
+ */
+int create_default_board(Board *board) {
+    if (allocate_board(board, BOARD_SIZE, DICE_MAX) == EXIT_FAILURE) {
+        return EXIT_FAILURE;
+    }
+    for (int j = 0; j < DICE_MAX; j++) {
+        board->dice[j] = 1;
+    }
+    for (int i = 0; i < NUM_OF_TRANSITIONS; i++) {
+        board->jump_to[transitions[i][0] - 1] = transitions[i][1];
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * the function parses the next token of the current config line as a
+ * positive number
+ * @param value set to the parsed number
+ * @return true if there is a positive number, else false
+ */
+static bool parse_positive(long *value) {
+    char *token = strtok(NULL, CONFIG_DELIMITERS), *endptr;
+    if (token == NULL) {
+        return false;
+    }
+    *value = strtol(token, &endptr, BASE);
+    return *endptr == '\0' && *value > 0 && *value <= INT_MAX;
+}
+
+/**
+ * the function checks that the current config line has no more tokens
+ * @return true if there are no more tokens, else false
+ */
+static bool at_line_end(void) {
+    return strtok(NULL, CONFIG_DELIMITERS) == NULL;
+}
+
+/**
+ * the function parses the "dice" line of a config: the weight of every face
+ * @param board the board, whose size is already set
+ * @return EXIT_SUCCESS if the line is valid, else EXIT_FAILURE
+ */
+static int parse_dice(Board *board) {
+    long weights[MAX_DICE_FACES], sum = 0;
+    int dice_max = 0;
+    for (char *token = strtok(NULL, CONFIG_DELIMITERS); token != NULL;
+         token = strtok(NULL, CONFIG_DELIMITERS)) {
+        char *endptr;
+        long weight = strtol(token, &endptr, BASE);
+        if (*endptr != '\0' || weight < 0 || weight > INT_MAX ||
+            dice_max == MAX_DICE_FACES) {
+            printf(INVALID_CONFIG_MESSAGE, "bad dice weights");
+            return EXIT_FAILURE;
+        }
+        weights[dice_max++] = weight;
+        sum += weight;
+    }
+    if (sum == 0) {
+        printf(INVALID_CONFIG_MESSAGE, "dice without weights");
+        return EXIT_FAILURE;
+    }
+    free(board->dice);
+    board->dice = malloc(sizeof(int) * dice_max);
+    if (board->dice == NULL) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        return EXIT_FAILURE;
+    }
+    board->dice_max = dice_max;
+    for (int j = 0; j < dice_max; j++) {
+        board->dice[j] = (int) weights[j];
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * the function parses the "jump" line of a config: a snake or a ladder
+ * @param board the board, whose size is already set
+ * @return EXIT_SUCCESS if the line is valid, else EXIT_FAILURE
+ */
+static int parse_jump(Board *board) {
+    long from, to;
+    if (!parse_positive(&from) || !parse_positive(&to) || !at_line_end() ||
+        from > board->size || to > board->size || from == to ||
+        from == board->size) {
+        printf(INVALID_CONFIG_MESSAGE, "bad jump");
+        return EXIT_FAILURE;
+    }
+    if (board->jump_to[from - 1] != EMPTY) {
+        printf(INVALID_CONFIG_MESSAGE, "two jumps from the same cell");
+        return EXIT_FAILURE;
+    }
+    board->jump_to[from - 1] = (int) to;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * the function parses one line of a config file
+ * @param board the board, allocated once its size is known
+ * @param line the line to parse
+ * @return EXIT_SUCCESS if the line is valid, else EXIT_FAILURE
+ */
+static int parse_config_line(Board *board, char *line) {
+    char *keyword = strtok(line, CONFIG_DELIMITERS);
+    if (keyword == NULL || keyword[0] == '#') {
+        return EXIT_SUCCESS; // empty line or comment
+    }
+    if (strcmp(keyword, SIZE_KEYWORD) == 0) {
+        long size;
+        if (board->jump_to != NULL) {
+            printf(INVALID_CONFIG_MESSAGE, "size must come first, once");
+            return EXIT_FAILURE;
+        }
+        // capped so that size + 1 and size * dice_max fit in an int
+        if (!parse_positive(&size) || !at_line_end() || size < 2 ||
+            size > MAX_BOARD_SIZE) {
+            printf(INVALID_CONFIG_MESSAGE, "bad size");
+            return EXIT_FAILURE;
+        }
+        return allocate_board(board, (int) size, DICE_MAX);
+    }
+    if (board->jump_to == NULL) {
+        printf(INVALID_CONFIG_MESSAGE, "size must come first, once");
+        return EXIT_FAILURE;
+    }
+    if (strcmp(keyword, "dice") == 0) {
+        return parse_dice(board);
+    }
+    if (strcmp(keyword, "jump") == 0) {
+        return parse_jump(board);
+    }
+    printf(INVALID_CONFIG_MESSAGE, keyword);
+    return EXIT_FAILURE;
+}
+
+/**
+ * the function checks whether a config line starts a new board
+ * @param line the line, not tokenized yet
+ * @return true if its keyword is size, else false
+ */
+static bool starts_board(const char *line) {
+    size_t length = strlen(SIZE_KEYWORD);
+    line += strspn(line, CONFIG_DELIMITERS);
+    return strncmp(line, SIZE_KEYWORD, length) == 0 &&
+           (line[length] == '\0' ||
+            strchr(CONFIG_DELIMITERS, line[length]) != NULL);
+}
+
+/**
+ * as described in board.h
+ */
+int read_board(BoardReader *reader, Board *board) {
+    int result = EXIT_SUCCESS;
+    while (result == EXIT_SUCCESS &&
+           (reader->pending || getline(&reader->line, &reader->line_capacity,
+                                       reader->fp) != -1)) {
+        if (board->jump_to != NULL && starts_board(reader->line)) {
+            reader->pending = true; // the first line of the next board
+            break;
+        }
+        reader->pending = false;
+        result = parse_config_line(board, reader->line);
+    }
+    if (board->jump_to == NULL) {
+        return result; // no more boards
+    }
+    long dice_sum = 0;
+    for (int j = 0; result == EXIT_SUCCESS && j < board->dice_max; j++) {
+        dice_sum += board->dice[j];
+    }
+    for (int j = 0; result == EXIT_SUCCESS && dice_sum == 0 &&
+                    j < board->dice_max; j++) { // no dice line
+        board->dice[j] = 1;
+    }
+    for (int i = 0; result == EXIT_SUCCESS && i < board->size; i++) {
+        int to = board->jump_to[i];
+        if (to != EMPTY && board->jump_to[to - 1] != EMPTY) {
+            printf(INVALID_CONFIG_MESSAGE, "jump to a cell with a jump");
+            result = EXIT_FAILURE;
+        }
+    }
+    if (result == EXIT_FAILURE) {
+        free_board(board);
+    }
+    return result;
+}
+
+/**
+ * as described in board.h
+ */
+void free_board_reader(BoardReader *reader) {
+    free(reader->line);
+    reader->line = NULL;
+    reader->line_capacity = 0;
+}
+
+/**
+ * as described in board.h
+ */
+int load_board(char *path, Board *board) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        printf("Error: problem with reading file path.\n");
+        return EXIT_FAILURE;
+    }
+    BoardReader reader = {fp, NULL, 0, false};
+    int result = read_board(&reader, board);
+    if (result == EXIT_SUCCESS && board->jump_to == NULL) {
+        printf(INVALID_CONFIG_MESSAGE, "missing size");
+        result = EXIT_FAILURE;
+    } else if (result == EXIT_SUCCESS && reader.pending) {
+        printf(INVALID_CONFIG_MESSAGE, "more than one board");
+        free_board(board);
+        result = EXIT_FAILURE;
+    }
+    free_board_reader(&reader);
+    fclose(fp);
+    return result;
+}
+
+/**
+ * as described in board.h
+ */
+void free_dense_board(DenseBoard *dense) {
+    free(dense->first);
+    dense->first = NULL;
+    free(dense->to);
+    dense->to = NULL;
+    free(dense->weight);
+    dense->weight = NULL;
+    free(dense->total);
+    dense->total = NULL;
+}
+
+/**
+ * as described in board.h
+ */
+int build_dense_board(Board *board, DenseBoard *dense) {
+    int *faces = malloc(sizeof(int) * board->dice_max);
+    if (faces == NULL) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        return EXIT_FAILURE;
+    }
+    // faces by descending weight, so the moves come out sorted
+    int positive = 0;
+    for (int j = 0; j < board->dice_max; j++) {
+        int k = j;
+        while (k > 0 && board->dice[faces[k - 1]] < board->dice[j]) {
+            faces[k] = faces[k - 1];
+            k--;
+        }
+        faces[k] = j;
+        positive += board->dice[j] > 0;
+    }
+    long capacity = (long) board->size * (positive > 0 ? positive : 1);
+    dense->size = board->size;
+    dense->first = malloc(sizeof(int) * (board->size + 1));
+    dense->total = malloc(sizeof(frequency_t) * board->size);
+    dense->to = NULL;
+    dense->weight = NULL;
+    if (capacity <= INT_MAX) {
+        dense->to = malloc(sizeof(int) * capacity);
+        dense->weight = malloc(sizeof(frequency_t) * capacity);
+    }
+    if (dense->first == NULL || dense->total == NULL || dense->to == NULL ||
+        dense->weight == NULL) {
+        free(faces);
+        free_dense_board(dense);
+        printf(ALLOCATION_ERROR_MASSAGE);
+        return EXIT_FAILURE;
+    }
+    int k = 0;
+    for (int i = 0; i < board->size; i++) {
+        dense->first[i] = k;
+        dense->total[i] = 0;
+        if (board->jump_to[i] != EMPTY) {
+            dense->to[k] = board->jump_to[i] - 1;
+            dense->weight[k++] = 1;
+            dense->total[i] = 1;
+            continue;
+        }
+        for (int j = 0; j < positive; j++) {
+            long index_to = (long) i + faces[j] + 1;
+            if (index_to < board->size) {
+                dense->to[k] = (int) index_to;
+                dense->weight[k++] = board->dice[faces[j]];
+                dense->total[i] += board->dice[faces[j]];
+            }
+        }
+    }
+    dense->first[board->size] = k;
+    free(faces);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * the function marks the cells reachable from the given sources by a
+ * breadth-first search
+ * @param first, to moves of the cells in CSR form
+ * @param size number of cells
+ * @param reached marked cells, sources are marked already
+ * @param queue room for size cells
+ * @param last index of a cell whose moves are not followed, -1 for none
+ */
+static void mark_reachable(const int *first, const int *to, int size,
+                           bool *reached, int *queue, int last) {
+    int head = 0, tail = 0;
+    for (int i = 0; i < size; i++) {
+        if (reached[i]) {
+            queue[tail++] = i;
+        }
+    }
+    while (head < tail) {
+        int cell = queue[head++];
+        for (int j = first[cell]; cell != last && j < first[cell + 1]; j++) {
+            if (!reached[to[j]]) {
+                reached[to[j]] = true;
+                queue[tail++] = to[j];
+            }
+        }
+    }
+}
+
+/**
+ * as described in board.h
+ */
+bool is_playable(DenseBoard *dense) {
+    int size = dense->size, num_moves = dense->first[size];
+    bool *reached = calloc(size, sizeof(bool));
+    bool *finishing = calloc(size, sizeof(bool));
+    int *queue = malloc(sizeof(int) * size);
+    int *reverse_first = calloc(size + 1, sizeof(int));
+    int *reverse_to = malloc(sizeof(int) * (num_moves + 1));
+    bool playable = reached != NULL && finishing != NULL && queue != NULL &&
+                    reverse_first != NULL && reverse_to != NULL;
+    if (!playable) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+    } else {
+        // the moves reversed, by a counting sort on their targets
+        for (int j = 0; j < num_moves; j++) {
+            reverse_first[dense->to[j] + 1]++;
+        }
+        for (int i = 0; i < size; i++) {
+            reverse_first[i + 1] += reverse_first[i];
+        }
+        for (int i = 0; i < size; i++) {
+            for (int j = dense->first[i]; j < dense->first[i + 1]; j++) {
+                reverse_to[reverse_first[dense->to[j]]++] = i;
+            }
+        }
+        for (int i = size; i > 0; i--) { // undo the shift of the fill
+            reverse_first[i] = reverse_first[i - 1];
+        }
+        reverse_first[0] = 0;
+        reached[0] = true;
+        mark_reachable(dense->first, dense->to, size, reached, queue,
+                       size - 1);
+        finishing[size - 1] = true;
+        mark_reachable(reverse_first, reverse_to, size, finishing, queue, -1);
+    }
+    for (int i = 0; playable && i < size - 1; i++) {
+        if (reached[i] && dense->first[i] == dense->first[i + 1]) {
+            printf(UNPLAYABLE_MESSAGE, i + 1, "has no moves");
+            playable = false;
+        }
+    }
+    for (int i = 0; playable && i < size - 1; i++) {
+        if (reached[i] && !finishing[i]) {
+            printf(UNPLAYABLE_MESSAGE, i + 1, "can't reach the last cell");
+            playable = false;
+        }
+    }
+    free(reached);
+    free(finishing);
+    free(queue);
+    free(reverse_first);
+    free(reverse_to);
+    return playable;
+}
+
+/**
+ * as described in board.h
+ */
+int get_next_dense_cell(DenseBoard *dense, int cell) {
+    int j = dense->first[cell], last = dense->first[cell + 1] - 1;
+    if (last < j || dense->total[cell] <= 0) {
+        return -1;
+    }
+    frequency_t i = get_random_frequency(dense->total[cell]);
+    while (j < last && i >= dense->weight[j]) {
+        i -= dense->weight[j];
+        j++;
+    }
+    return dense->to[j];
+}
+
+/**
+ * the function checks if the cell is last - if the cell's number is the
+ * board's size
+ * @param data a cell
+ * @return true if the cell is last, else false
+ */
+static bool check_if_last(void *data) {
+    Cell *cell = data;
+    return cell->is_last;
+}
+
+/**
+ * the function comperes 2 cells by its numbers
+ * @param data1 first cell
+ * @param data2 second cell
+ * @return the function returns 0 if equal
+ * a positive value if the first is bigger
+ * a negative value if the second is bigger
+ */
+static int comp_cells(void *data1, void *data2) {
+    Cell *cell1 = data1;
+    Cell *cell2 = data2;
+    return (cell1->number - cell2->number);
+}
+
+/**
+ * the function allocates and copies the given data into a new cell
+ * @param data
+ * @return the new allocated cell if the allocation succeeded, else NULL.
+ */
+static void *copy_cell(void *data) {
+    Cell *ptr_src = data;
+    Cell *new_cell = malloc(sizeof(Cell));
+    if (new_cell == NULL) {
+        return NULL;
+    }
+    *new_cell = *ptr_src;
+    return new_cell;
+}
+
+/**
+ * the function hashes a cell by its number
+ * @param data the cell to hash
+ * @return the hash value of the cell
+ */
+static unsigned long hash_cell(void *data) {
+    Cell *cell = data;
+    return (unsigned long) cell->number;
+}
+
+/**
+ * the function prints the cell's number in a specific form
+ * @param data the cell for print
+ */
+static void print_cell(void *data) {
+    Cell *cell = data;
+    if (cell->is_last) {
+        printf("[%d]", cell->number);
+    } else if ((cell->snake_to != EMPTY)) {
+        printf("[%d]-snake to %d -> ", cell->number, cell->snake_to);
+    } else if ((cell->ladder_to != EMPTY)) {
+        printf("[%d]-ladder to %d -> ", cell->number, cell->ladder_to);
+    } else {
+        printf("[%d] -> ", cell->number);
+    }
+}
+
+/**
+ * as described in board.h
+ */
+void initializing_board_chain(MarkovChain *markov_chain,
+                              LinkedList *database) {
+    markov_chain->database = database;
+    markov_chain->database->first = NULL;
+    markov_chain->database->last = NULL;
+    markov_chain->database->size = 0;
+    markov_chain->print_func = print_cell;
+    markov_chain->is_last = check_if_last;
+    markov_chain->free_data = free;
+    markov_chain->comp_func = comp_cells;
+    markov_chain->copy_func = copy_cell;
+    markov_chain->hash = hash_cell;
+    markov_chain->buckets = NULL;
+    markov_chain->num_buckets = 0;
+    markov_chain->decay = 1;
+    markov_chain->epoch = 0;
+}
+
+/**
+ * as described in board.h
+ */
+int fill_board_database(MarkovChain *markov_chain, Board *board,
+                        DenseBoard *dense) {
+    MarkovNode **states = malloc(sizeof(MarkovNode *) * board->size);
+    if (states == NULL) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < board->size; i++) {
+        int to = board->jump_to[i];
+        Cell cell = {i + 1, to > i + 1 ? to : EMPTY,
+                     to != EMPTY && to < i + 1 ? to : EMPTY,
+                     i + 1 == board->size};
+        Node *node = add_to_database(markov_chain, &cell);
+        if (node == NULL) {
+            free(states);
+            return EXIT_FAILURE;
+        }
+        states[i] = node->data;
+    }
+    for (int i = 0; i < board->size; i++) {
+        MarkovNode *from_node = states[i];
+        int first = dense->first[i], len = dense->first[i + 1] - first;
+        from_node->frequencies_list = malloc(sizeof(MarkovNodeFrequency) *
+                                             (len + 1));
+        if (from_node->frequencies_list == NULL) {
+            free(states);
+            printf(ALLOCATION_ERROR_MASSAGE);
+            return EXIT_FAILURE;
+        }
+        for (int j = 0; j < len; j++) {
+            from_node->frequencies_list[j] = (MarkovNodeFrequency) {
+                    states[dense->to[first + j]], dense->weight[first + j]};
+        }
+        from_node->frequencies_list_len = len;
+        from_node->frequencies_sum = dense->total[i];
+    }
+    free(states);
+    return EXIT_SUCCESS;
+}
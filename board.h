@@ -0,0 +1,174 @@
+#ifndef _BOARD_H
+#define _BOARD_H
+
+#include <limits.h> // For INT_MAX
+#include "markov_chain.h"
+
+#define EMPTY -1
+#define BOARD_SIZE 100
+#define DICE_MAX 6
+#define MAX_DICE_FACES 100
+#define MAX_BOARD_SIZE (INT_MAX / MAX_DICE_FACES)
+
+/***************************/
+/*        STRUCTS          */
+/***************************/
+
+/**
+ * struct represents a Cell in the game board
+ */
+typedef struct Cell {
+    int number; // Cell number 1-board size
+    int ladder_to;  // ladder_to represents the jump of the ladder in case
+    // there is one from this square
+    int snake_to;  // snake_to represents the jump of the snake in case there
+    // is one from this square
+    //both ladder_to and snake_to should be -1 if the Cell doesn't have them
+    bool is_last; // true for the last cell of the board
+} Cell;
+
+/**
+ * struct represents a board configuration
+ */
+typedef struct Board {
+    int size; // number of cells, 0 for no board
+    int dice_max; // number of faces of the dice
+    int *dice; // dice[j] is the weight of rolling j + 1
+    int *jump_to; // jump_to[i] is where the snake or ladder at cell i + 1
+    // leads, EMPTY if there is none
+} Board;
+
+/**
+ * The moves of a board in dense arrays indexed by cell: the moves from the
+ * cell with index i lead to the cells with indices to[first[i]] ..
+ * to[first[i + 1] - 1], with the weights weight[first[i]] ..
+ * weight[first[i + 1] - 1], sorted by descending weight. A snake or a
+ * ladder is a single move of weight 1.
+ */
+typedef struct DenseBoard {
+    int size; // number of cells
+    int *first; // size + 1 offsets into to and weight
+    int *to;
+    frequency_t *weight;
+    frequency_t *total; // sum of the weights of the moves of every cell
+} DenseBoard;
+
+/**
+ * A config file being read board by board with read_board.
+ */
+typedef struct BoardReader {
+    FILE *fp;
+    char *line;
+    size_t line_capacity;
+    bool pending; // line holds the first line of the next board
+} BoardReader;
+
+/**
+ * Allocate the arrays of a board with no snakes and ladders and a dice
+ * without weights.
+ * @param board the board to allocate
+ * @param size number of cells
+ * @param dice_max number of faces of the dice
+ * @return EXIT_SUCCESS if the board is allocated successfully, else
+ * EXIT_FAILURE
+ */
+int allocate_board(Board *board, int size, int dice_max);
+
+/**
+ * Free the arrays of a board.
+ * @param board
+ */
+void free_board(Board *board);
+
+/**
+ * Build the default board: 100 cells, a fair 6 faces dice and 20 snakes and
+ * ladders.
+ * @param board the board to build
+ * @return EXIT_SUCCESS if the board is built successfully, else EXIT_FAILURE
+ */
+int create_default_board(Board *board);
+
+/**
+ * Read the next board of a config file. Every line holds a keyword and its
+ * numbers, lines starting with '#' are comments:
+ *   size N          - number of cells, 2 to MAX_BOARD_SIZE, starts a board
+ *   dice W1 W2 ...  - weight of rolling every face, a fair 6 faces dice if
+ *                     missing
+ *   jump FROM TO    - a ladder if FROM < TO, a snake otherwise, to a cell
+ *                     without a jump
+ * @param reader the config file, zero initialized but for fp
+ * @param board the board to read, zero initialized. Its size stays 0 if
+ * there are no more boards.
+ * @return EXIT_SUCCESS if a board is read or there are no more boards, else
+ * EXIT_FAILURE
+ */
+int read_board(BoardReader *reader, Board *board);
+
+/**
+ * Free the line buffer of a reader, but don't close its file.
+ * @param reader
+ */
+void free_board_reader(BoardReader *reader);
+
+/**
+ * Load a config file of a single board, see read_board.
+ * @param path the path of the config file
+ * @param board the board to load, zero initialized
+ * @return EXIT_SUCCESS if the board is loaded successfully, else
+ * EXIT_FAILURE
+ */
+int load_board(char *path, Board *board);
+
+/**
+ * Build the moves of a board as dense arrays, in one pass over its cells.
+ * @param board
+ * @param dense the arrays to build
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of allocation error
+ */
+int build_dense_board(Board *board, DenseBoard *dense);
+
+/**
+ * Free the arrays of a dense board.
+ * @param dense
+ */
+void free_dense_board(DenseBoard *dense);
+
+/**
+ * Check that a board can be played: every cell a walk from the first cell
+ * can reach, other than the last one, has moves and a way to the last cell.
+ * Prints the reason if it can't be played.
+ * @param dense the moves of the board
+ * @return true if the board can be played, else false
+ */
+bool is_playable(DenseBoard *dense);
+
+/**
+ * Choose randomly the next cell, depend on the weights of the moves. Makes
+ * the same choice as get_next_random_node on the chain filled by
+ * fill_board_database for the same random numbers.
+ * @param dense
+ * @param cell index of the cell to move from
+ * @return index of the chosen cell, -1 if the cell has no moves
+ */
+int get_next_dense_cell(DenseBoard *dense, int cell);
+
+/**
+ * Initialize a new markov chain of cells.
+ * @param markov_chain the new marko chain
+ * @param database the database to put in the chain
+ */
+void initializing_board_chain(MarkovChain *markov_chain,
+                              LinkedList *database);
+
+/**
+ * Fill the database of a chain of cells from a board and its dense moves,
+ * adding the cells in order.
+ * @param markov_chain an empty chain initialized by initializing_board_chain
+ * @param board
+ * @param dense the moves of the board built by build_dense_board
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int fill_board_database(MarkovChain *markov_chain, Board *board,
+                        DenseBoard *dense);
+
+#endif /* _BOARD_H */
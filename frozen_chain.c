@@ -0,0 +1,244 @@
+#define _DEFAULT_SOURCE // For MAP_ANONYMOUS, MAP_HUGETLB, MADV_HUGEPAGE
+#include "frozen_chain.h"
+#include <string.h> // For memcpy(), strncmp()
+#include <sys/mman.h> // For mmap(), madvise(), munmap()
+#include <dirent.h> // For opendir(), readdir(), closedir()
+#include <ctype.h> // For isdigit()
+#include <unistd.h> // For sysconf()
+
+#define CACHE_LINE 64
+#define CPU_PATH_LENGTH 64
+#define NODE_PREFIX "node"
+#define NODE_PREFIX_LENGTH 4
+#define ALIGN_UP(X, ALIGNMENT) (((X) + (ALIGNMENT) - 1) / (ALIGNMENT) * \
+(ALIGNMENT))
+
+/**
+ * Map anonymous memory starting on a multiple of an alignment, by mapping
+ * alignment more bytes and unmapping the parts before and after it.
+ * @param size number of bytes to map, a multiple of the page size
+ * @param alignment the alignment, a multiple of the page size
+ * @return the mapping, NULL in case of allocation error
+ */
+static void *map_aligned(size_t size, size_t alignment) {
+    char *memory = mmap(NULL, size + alignment, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return NULL;
+    }
+    char *start = (char *) ALIGN_UP((uintptr_t) memory, alignment);
+    if (start > memory) {
+        munmap(memory, start - memory);
+    }
+    munmap(start + size, memory + alignment - start);
+    return start;
+}
+
+/**
+ * Map anonymous memory for the arrays of a frozen chain. Hugepage
+ * mappings are rounded to and aligned on HUGEPAGE_SIZE, so that every
+ * part of them can be backed by a hugepage; regular ones are rounded to
+ * the page size.
+ * @param size number of bytes needed
+ * @param placement the placement to try, set to the one achieved
+ * @param mapped_size set to the size of the mapping
+ * @return the mapping, NULL in case of allocation error
+ */
+static void *map_memory(size_t size, Placement *placement,
+                        size_t *mapped_size) {
+    void *memory;
+#ifdef MAP_HUGETLB
+    if (*placement == PLACEMENT_HUGEPAGES) {
+        *mapped_size = ALIGN_UP(size, HUGEPAGE_SIZE);
+        memory = mmap(NULL, *mapped_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory != MAP_FAILED) {
+            return memory;
+        }
+        // no hugepages reserved, fall back to transparent hugepages
+        *placement = PLACEMENT_TRANSPARENT_HUGEPAGES;
+    }
+#endif
+#ifdef MADV_HUGEPAGE
+    if (*placement != PLACEMENT_PAGES) {
+        *mapped_size = ALIGN_UP(size, HUGEPAGE_SIZE);
+        memory = map_aligned(*mapped_size, HUGEPAGE_SIZE);
+        if (memory == NULL) {
+            return NULL;
+        }
+        *placement = madvise(memory, *mapped_size, MADV_HUGEPAGE) == 0 ?
+                     PLACEMENT_TRANSPARENT_HUGEPAGES : PLACEMENT_PAGES;
+        return memory;
+    }
+#endif
+    *placement = PLACEMENT_PAGES;
+    *mapped_size = ALIGN_UP(size, (size_t) sysconf(_SC_PAGESIZE));
+    memory = mmap(NULL, *mapped_size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return memory != MAP_FAILED ? memory : NULL;
+}
+
+/**
+ * Allocate an empty frozen chain with room for the given number of states
+ * and transitions.
+ * @return the frozen chain, NULL in case of allocation error
+ */
+static FrozenChain *allocate_frozen_chain(MarkovChain *markov_chain,
+                                          int num_states, int num_edges,
+                                          Placement placement) {
+    FrozenChain *frozen = malloc(sizeof(FrozenChain));
+    if (frozen == NULL) {
+        return NULL;
+    }
+    size_t edges_offset = ALIGN_UP(sizeof(FrozenState) * num_states,
+                                   CACHE_LINE);
+    size_t size = edges_offset + sizeof(FrozenEdge) * num_edges + 1;
+    frozen->memory = map_memory(size, &placement, &frozen->size);
+    if (frozen->memory == NULL) {
+        free(frozen);
+        return NULL;
+    }
+    frozen->markov_chain = markov_chain;
+    frozen->states = frozen->memory;
+    frozen->edges = (FrozenEdge *) ((char *) frozen->memory + edges_offset);
+    frozen->num_states = num_states;
+    frozen->num_edges = num_edges;
+    frozen->placement = placement;
+    return frozen;
+}
+
+/**
+ * as described in frozen_chain.h
+ */
+FrozenChain *freeze_chain(MarkovChain *markov_chain, bool hugepages) {
+    int num_edges = 0;
+    for (Node *cur = markov_chain->database->first; cur; cur = cur->next) {
+        num_edges += cur->data->frequencies_list_len;
+    }
+    FrozenChain *frozen = allocate_frozen_chain(
+            markov_chain, markov_chain->database->size, num_edges,
+            hugepages ? PLACEMENT_HUGEPAGES : PLACEMENT_PAGES);
+    if (frozen == NULL) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        return NULL;
+    }
+    int first_edge = 0;
+    for (Node *cur = markov_chain->database->first; cur; cur = cur->next) {
+        MarkovNode *node = cur->data;
+        frozen->states[node->index] = (FrozenState) {
+                node->data, first_edge, node->frequencies_list_len,
+                markov_chain->is_last(node->data)};
+        frequency_t cumulative = 0;
+        for (int j = 0; j < node->frequencies_list_len; j++) {
+            cumulative += node->frequencies_list[j].frequency;
+            frozen->edges[first_edge++] = (FrozenEdge) {
+                    node->frequencies_list[j].markov_node->index, cumulative};
+        }
+    }
+    return frozen;
+}
+
+/**
+ * as described in frozen_chain.h
+ */
+FrozenChain *replicate_frozen_chain(const FrozenChain *frozen) {
+    FrozenChain *replica = allocate_frozen_chain(
+            frozen->markov_chain, frozen->num_states, frozen->num_edges,
+            frozen->placement);
+    if (replica == NULL) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        return NULL;
+    }
+    memcpy(replica->states, frozen->states,
+           sizeof(FrozenState) * frozen->num_states);
+    memcpy(replica->edges, frozen->edges,
+           sizeof(FrozenEdge) * frozen->num_edges);
+    return replica;
+}
+
+/**
+ * as described in frozen_chain.h
+ */
+int get_numa_node(int cpu) {
+    char path[CPU_PATH_LENGTH];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        return 0;
+    }
+    int node = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        // the CPU's directory links to its node as nodeN
+        if (strncmp(entry->d_name, NODE_PREFIX, NODE_PREFIX_LENGTH) == 0 &&
+            isdigit((unsigned char) entry->d_name[NODE_PREFIX_LENGTH])) {
+            node = atoi(entry->d_name + NODE_PREFIX_LENGTH);
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+/**
+ * as described in frozen_chain.h
+ */
+void free_frozen_chain(FrozenChain **frozen) {
+    munmap((*frozen)->memory, (*frozen)->size);
+    free(*frozen);
+    *frozen = NULL;
+}
+
+/**
+ * as described in frozen_chain.h
+ */
+int get_next_frozen_state(const FrozenChain *frozen, int state) {
+    return get_next_frozen_state_r(frozen, state, NULL);
+}
+
+/**
+ * as described in frozen_chain.h
+ */
+int get_next_frozen_state_r(const FrozenChain *frozen, int state,
+                            unsigned int *seed) {
+    const FrozenState *current = &frozen->states[state];
+    if (current->num_edges == 0) {
+        return -1;
+    }
+    const FrozenEdge *edges = frozen->edges + current->first_edge;
+    int last = current->num_edges - 1;
+    if (edges[last].cumulative <= 0) {
+        return -1;
+    }
+    frequency_t i = get_random_frequency_r(edges[last].cumulative, seed);
+    int low = 0, high = last; // first edge whose cumulative is above i
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (edges[mid].cumulative > i) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return edges[low].to;
+}
+
+/**
+ * as described in frozen_chain.h
+ */
+void generate_frozen_tweet(const FrozenChain *frozen, int first_state,
+                           int max_length) {
+    MarkovChain *markov_chain = frozen->markov_chain;
+    markov_chain->print_func(frozen->states[first_state].data);
+    for (int i = 1; i < max_length; i++) {
+        int next_state = get_next_frozen_state(frozen, first_state);
+        if (next_state == -1) { // no successors
+            break;
+        }
+        markov_chain->print_func(frozen->states[next_state].data);
+        if (frozen->states[next_state].is_last) {//the end
+            break;
+        }
+        first_state = next_state;
+    }
+}
@@ -0,0 +1,116 @@
+#ifndef _FROZEN_CHAIN_H
+#define _FROZEN_CHAIN_H
+
+#include "markov_chain.h"
+
+#define HUGEPAGE_SIZE (2 * 1024 * 1024)
+
+/***************************/
+/*        STRUCTS          */
+/***************************/
+
+/**
+ * How the arrays of a FrozenChain are placed in memory.
+ */
+typedef enum Placement {
+    PLACEMENT_PAGES, // regular pages
+    PLACEMENT_TRANSPARENT_HUGEPAGES, // regular pages, advised to the kernel
+    // to back them with transparent hugepages
+    PLACEMENT_HUGEPAGES // explicit 2 MB hugepages
+} Placement;
+
+typedef struct FrozenState {
+    void *data; // data of the state in the chain it was frozen from
+    int first_edge; // the transitions of the state are
+    // edges[first_edge] .. edges[first_edge + num_edges - 1]
+    int num_edges;
+    bool is_last;
+} FrozenState;
+
+typedef struct FrozenEdge {
+    int to; // index of the successor
+    frequency_t cumulative; // sum of the frequencies of the state's
+    // transitions up to and including this one
+} FrozenEdge;
+
+/**
+ * A read-only copy of a MarkovChain in two contiguous arrays, indexed by
+ * the index of the states, in a single memory mapping.
+ */
+typedef struct FrozenChain {
+    MarkovChain *markov_chain; // the chain it was frozen from
+    FrozenState *states;
+    FrozenEdge *edges;
+    int num_states;
+    int num_edges;
+    void *memory; // the mapping holding both arrays
+    size_t size; // size of the mapping
+    Placement placement;
+} FrozenChain;
+
+/**
+ * Freeze a chain into contiguous arrays. The frozen chain refers to the
+ * data of the chain's states, so the chain must outlive it and must not
+ * change.
+ * @param markov_chain the chain to freeze
+ * @param hugepages true to place the arrays on 2 MB hugepages if the
+ * system has them reserved, or else on transparent hugepages
+ * @return the frozen chain, NULL in case of allocation error
+ */
+FrozenChain *freeze_chain(MarkovChain *markov_chain, bool hugepages);
+
+/**
+ * Copy a frozen chain, with the same placement. The copy is written by the
+ * calling thread, so under the default first-touch policy its pages are
+ * placed on the NUMA node that thread runs on: the first generation thread
+ * pinned to a node should make the node's replica, and the other threads of
+ * the node should share it (see get_numa_node).
+ * @param frozen the frozen chain to copy
+ * @return the copy, NULL in case of allocation error
+ */
+FrozenChain *replicate_frozen_chain(const FrozenChain *frozen);
+
+/**
+ * Find the NUMA node of a CPU, from /sys/devices/system/cpu.
+ * @param cpu the CPU
+ * @return the node, 0 if it can't be found (a system without NUMA)
+ */
+int get_numa_node(int cpu);
+
+/**
+ * Free a frozen chain, but not the chain it was frozen from.
+ * @param frozen the frozen chain to free
+ */
+void free_frozen_chain(FrozenChain **frozen);
+
+/**
+ * Choose randomly the next state, depend on it's occurrence frequency.
+ * With integer frequencies, makes the same choice as get_next_random_node
+ * for the same random numbers.
+ * @param frozen the frozen chain
+ * @param state index of the state to choose from
+ * @return index of the chosen state, -1 if it has no successors
+ */
+int get_next_frozen_state(const FrozenChain *frozen, int state);
+
+/**
+ * Like get_next_frozen_state, but draws from rand_r with the given seed, so
+ * that threads can walk independently.
+ * @param frozen the frozen chain
+ * @param state index of the state to choose from
+ * @param seed the state of rand_r, NULL to use rand
+ * @return index of the chosen state, -1 if it has no successors
+ */
+int get_next_frozen_state_r(const FrozenChain *frozen, int state,
+                            unsigned int *seed);
+
+/**
+ * Like generate_tweet, on a frozen chain.
+ * @param frozen the frozen chain
+ * @param first_state index of the state to start with
+ * @param max_length maximum length of chain to generate
+ */
+void generate_frozen_tweet(const FrozenChain *frozen, int first_state,
+                           int max_length);
+
+#endif /* _FROZEN_CHAIN_H */
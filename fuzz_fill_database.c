@@ -0,0 +1,123 @@
+#define _POSIX_C_SOURCE 200809L // For fmemopen()
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "markov_chain.h"
+#include "words.h"
+
+/**
+ * Fuzz target of fill_word_database: the input is a tweets file, trained
+ * with linear and with hashed lookups. Both chains must be consistent and
+ * equal; any violation aborts, so the fuzzer reports the input.
+ * Built with -fsanitize=fuzzer and MARKOV_LIBFUZZER defined it is a
+ * libFuzzer target; otherwise main replays the files given to it, such as a
+ * corpus or the crashes the fuzzer found.
+ */
+
+/**
+ * the function trains a new chain of words on a file
+ * @param fp the file
+ * @param hash hash function of the chain, NULL for linear lookups
+ * @return the chain, NULL on failure
+ */
+static MarkovChain *train(FILE *fp, hash_func hash) {
+    MarkovChain *markov_chain = malloc(sizeof(MarkovChain));
+    LinkedList *database = malloc(sizeof(LinkedList));
+    if (markov_chain == NULL || database == NULL) {
+        free(markov_chain);
+        free(database);
+        return NULL;
+    }
+    initializing_word_chain(markov_chain, database);
+    markov_chain->hash = hash;
+    if (fill_word_database(fp, NO_WORDS, markov_chain)) {
+        free_database(&markov_chain);
+    }
+    return markov_chain;
+}
+
+/**
+ * libFuzzer entry point
+ * @param data the input
+ * @param size size of the input
+ * @return 0
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (size == 0) {
+        return 0; // an empty file, and fmemopen rejects empty buffers
+    }
+    FILE *fp = fmemopen((void *) data, size, "r");
+    if (fp == NULL) {
+        return 0;
+    }
+    MarkovChain *linear = train(fp, NULL);
+    rewind(fp);
+    MarkovChain *hashed = train(fp, hash_word);
+    fclose(fp);
+    if (linear == NULL || hashed == NULL || !is_chain_consistent(linear) ||
+        !is_chain_consistent(hashed) || !chains_equal(linear, hashed)) {
+        abort();
+    }
+    free_database(&linear);
+    free_database(&hashed);
+    return 0;
+}
+
+#ifndef MARKOV_LIBFUZZER
+/**
+ * the function reads a whole file
+ * @param path the path of the file
+ * @param size set to the size of the file
+ * @return the content, NULL on failure
+ */
+static uint8_t *read_file(char *path, size_t *size) {
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        printf("Error: problem with reading file %s\n", path);
+        return NULL;
+    }
+    size_t capacity = BUFSIZ;
+    uint8_t *data = malloc(capacity);
+    *size = 0;
+    while (data != NULL) {
+        *size += fread(data + *size, 1, capacity - *size, fp);
+        if (*size < capacity) {
+            break;
+        }
+        uint8_t *temp = realloc(data, capacity * 2);
+        if (temp == NULL) {
+            free(data);
+        }
+        data = temp;
+        capacity *= 2;
+    }
+    if (data == NULL) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+    }
+    fclose(fp);
+    return data;
+}
+
+/**
+ * @param argc num of arguments
+ * @param argv 1...) Inputs to replay
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Usage: fuzz_fill_database <input>...\n");
+        return EXIT_FAILURE;
+    }
+    for (int i = 1; i < argc; i++) {
+        size_t size;
+        uint8_t *data = read_file(argv[i], &size);
+        if (data == NULL) {
+            return EXIT_FAILURE;
+        }
+        LLVMFuzzerTestOneInput(data, size);
+        free(data);
+    }
+    printf("Replayed %d inputs\n", argc - 1);
+    return EXIT_SUCCESS;
+}
+#endif
@@ -1,4 +1,210 @@
+#define _POSIX_C_SOURCE 200809L // For rand_r()
 #include "markov_chain.h"
+#include <pthread.h> // For pthread_create(), pthread_join()
+
+#define UNREACHABLE -1
+#define MIN_BUCKETS 16
+#define MIN(X, Y) (((X) < (Y)) ? (X) : (Y))
+#define RANDOM_CHUNK_BITS 15 // rand() gives at least 15 random bits
+#define RANDOM_CHUNK_MASK 0x7FFF
+#define RANDOM_CHUNKS 5 // enough chunks for 64 bits
+
+/**
+ * get random number in [0, RAND_MAX] from rand, or from rand_r
+ * @param seed the state of rand_r, NULL to use rand
+ * @return random number
+ */
+static int get_random_int(unsigned int *seed) {
+    return seed == NULL ? rand() : rand_r(seed);
+}
+
+/**
+ * get random number in [0,1)
+ * @param seed the state of rand_r, NULL to use rand
+ * @return random number
+ */
+static double get_random_unit(unsigned int *seed) {
+    return get_random_int(seed) / ((double) RAND_MAX + 1);
+}
+
+/**
+ * as described in markov_chain.h
+ */
+frequency_t get_random_frequency(frequency_t max_number) {
+    return get_random_frequency_r(max_number, NULL);
+}
+
+/**
+ * as described in markov_chain.h
+ */
+frequency_t get_random_frequency_r(frequency_t max_number,
+                                   unsigned int *seed) {
+#ifdef MARKOV_FRACTIONAL_FREQUENCIES
+    return get_random_unit(seed) * max_number;
+#else
+    uint64_t range = (uint64_t) RAND_MAX + 1, value, limit;
+    if (max_number <= range) {
+        limit = range - range % max_number; // reject the uneven remainder
+        do {
+            value = (uint64_t) get_random_int(seed);
+        } while (value >= limit);
+        return value % max_number;
+    }
+    limit = -max_number % max_number; // 2^64 % max_number
+    do {
+        value = 0;
+        for (int i = 0; i < RANDOM_CHUNKS; i++) {
+            value = (value << RANDOM_CHUNK_BITS) |
+                    ((uint64_t) get_random_int(seed) & RANDOM_CHUNK_MASK);
+        }
+    } while (value < limit);
+    return value % max_number;
+#endif
+}
+
+/**
+ * Decay the frequencies of node to the current epoch of the chain. Entries
+ * that decay to 0 are dropped, they are no transitions anymore.
+ */
+static void decay_node(MarkovChain *markov_chain, MarkovNode *node) {
+#ifdef MARKOV_FRACTIONAL_FREQUENCIES
+    if (node->epoch != markov_chain->epoch) {
+        double factor = pow(markov_chain->decay,
+                            (double) (markov_chain->epoch - node->epoch));
+        node->frequencies_sum = 0;
+        for (int j = 0; j < node->frequencies_list_len; j++) {
+            node->frequencies_list[j].frequency *= factor;
+            node->frequencies_sum += node->frequencies_list[j].frequency;
+        }
+        // the list stays sorted, so the zeros are at its end
+        while (node->frequencies_list_len > 0 &&
+               node->frequencies_list[node->frequencies_list_len - 1]
+                       .frequency <= 0) {
+            node->frequencies_list_len--;
+        }
+    }
+#endif
+    node->epoch = markov_chain->epoch;
+}
+
+/**
+ * Get a frequency of node as if node was decayed to the current epoch of
+ * the chain, without decaying it.
+ */
+static frequency_t get_decayed(MarkovChain *markov_chain, MarkovNode *node,
+                               frequency_t frequency) {
+#ifdef MARKOV_FRACTIONAL_FREQUENCIES
+    return frequency * pow(markov_chain->decay,
+                           (double) (markov_chain->epoch - node->epoch));
+#else
+    (void) markov_chain;
+    (void) node;
+    return frequency; // counts never decay, and stay exact
+#endif
+}
+
+/**
+ * Choose the successor at the given position of the cumulative frequencies
+ * of the first len successors of node.
+ * @param node the node to choose from
+ * @param len number of successors to choose from
+ * @param i position in [0, sum of their frequencies)
+ * @return the chosen successor
+ */
+static MarkovNode *find_successor(MarkovNode *node, int len, frequency_t i) {
+    MarkovNodeFrequency *current = node->frequencies_list;
+    MarkovNodeFrequency *last = node->frequencies_list + len - 1;
+    while (current < last && i >= current->frequency) {
+        i -= current->frequency;
+        current++;
+    }
+    return current->markov_node;
+}
+
+/**
+ * Move the entry at index i of a frequencies list toward the front until
+ * the list is sorted by descending frequency again.
+ */
+static void move_up(MarkovNodeFrequency *list, int i) {
+    while (i > 0 && list[i - 1].frequency < list[i].frequency) {
+        MarkovNodeFrequency temp = list[i - 1];
+        list[i - 1] = list[i];
+        list[i] = temp;
+        i--;
+    }
+}
+
+/**
+ * Insert node to the chain's hash index, without growing it.
+ */
+static void insert_to_index(MarkovChain *markov_chain, Node *node) {
+    int mask = markov_chain->num_buckets - 1;
+    int i = (int) (markov_chain->hash(node->data->data) & mask);
+    while (markov_chain->buckets[i] != NULL) {
+        i = (i + 1) & mask;
+    }
+    markov_chain->buckets[i] = node;
+}
+
+/**
+ * Add the last node of the database to the chain's hash index, growing the
+ * index when it is half full. If the index can't be allocated it is
+ * dropped, and lookups fall back to scanning the database.
+ */
+static void add_to_index(MarkovChain *markov_chain) {
+    if (markov_chain->hash == NULL) {
+        return;
+    }
+    if (markov_chain->database->size * 2 > markov_chain->num_buckets) {
+        int num_buckets = MIN_BUCKETS;
+        while (markov_chain->database->size * 2 > num_buckets) {
+            num_buckets *= 2;
+        }
+        free(markov_chain->buckets);
+        markov_chain->buckets = calloc(num_buckets, sizeof(Node *));
+        if (markov_chain->buckets == NULL) {
+            markov_chain->num_buckets = 0;
+            return;
+        }
+        markov_chain->num_buckets = num_buckets;
+        for (Node *cur = markov_chain->database->first; cur;
+             cur = cur->next) {
+            insert_to_index(markov_chain, cur);
+        }
+        return;
+    }
+    insert_to_index(markov_chain, markov_chain->database->last);
+}
+
+/**
+ * Create a new node wrapping a copy of data_ptr and add it to the end of
+ * markov_chain's database, without checking whether it is already there.
+ * @param markov_chain the chain to add to
+ * @param data_ptr the state to add
+ * @return the new node, NULL in case of allocation error
+ */
+static Node* append_to_database(MarkovChain *markov_chain, void *data_ptr){
+    MarkovNode *m_node = malloc(sizeof(MarkovNode));
+    if (m_node == NULL) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        return NULL;
+    }
+    void* data = markov_chain->copy_func(data_ptr);
+    if(data == NULL){
+        printf(ALLOCATION_ERROR_MASSAGE);
+        free(m_node);
+        return NULL;
+    }
+    *m_node = (MarkovNode) {data, NULL, 0, markov_chain->database->size, 0,
+                            markov_chain->epoch};
+    if (add(markov_chain->database, m_node)) {
+        markov_chain->free_data(data);
+        free(m_node);
+        return NULL; // failed to add
+    }
+    add_to_index(markov_chain);
+    return markov_chain->database->last;
+}
 
 /**
 * If data_ptr in markov_chain, return it's node. Otherwise, create new
@@ -11,29 +217,26 @@ Node* add_to_database(MarkovChain *markov_chain, void *data_ptr){
     Node *result = get_node_from_database(markov_chain, data_ptr);
     if (result != NULL) {
         return result;// the given data exists
-    } else {
-        MarkovNode *m_node = malloc(sizeof(MarkovNode));
-        if (m_node == NULL) {
-            printf(ALLOCATION_ERROR_MASSAGE);
-            return NULL;
-        }
-        void* data = markov_chain->copy_func(data_ptr);
-        if(data == NULL){
-            printf(ALLOCATION_ERROR_MASSAGE);
-            return NULL;
-        }
-        *m_node = (MarkovNode) {data, NULL, 0};
-        if (add(markov_chain->database, m_node)) {
-            return NULL; // failed to add
-        }
-        return markov_chain->database->last;
     }
+    return append_to_database(markov_chain, data_ptr);
 }
 
 /**
  * as described in markov_chain.h
  */
 Node* get_node_from_database(MarkovChain *markov_chain, void *data_ptr){
+    if (markov_chain->buckets != NULL) {
+        int mask = markov_chain->num_buckets - 1;
+        int i = (int) (markov_chain->hash(data_ptr) & mask);
+        while (markov_chain->buckets[i] != NULL) {
+            if (markov_chain->comp_func(markov_chain->buckets[i]->data->data,
+                                        data_ptr) == 0) {
+                return markov_chain->buckets[i];
+            }
+            i = (i + 1) & mask;
+        }
+        return NULL;
+    }
     Node *current = markov_chain->database->first;
     while (current) { //searching if the given data is already in the chain
         if (markov_chain->comp_func(current->data->data, data_ptr) == 0) {
@@ -49,10 +252,14 @@ Node* get_node_from_database(MarkovChain *markov_chain, void *data_ptr){
  */
 bool add_node_to_frequencies_list(MarkovNode *first_node, MarkovNode
 *second_node, MarkovChain *markov_chain){
+    decay_node(markov_chain, first_node);
     for (int i = 0; i < first_node->frequencies_list_len; i++) {
         if (markov_chain->comp_func(second_node->data,
                    first_node->frequencies_list[i].markov_node->data) == 0) {
             first_node->frequencies_list[i].frequency++;
+            first_node->frequencies_sum++;
+            // keep the list sorted by descending frequency
+            move_up(first_node->frequencies_list, i);
             return true;
         }
     }
@@ -77,7 +284,11 @@ bool add_node_to_frequencies_list(MarkovNode *first_node, MarkovNode
     }
     first_node->frequencies_list[(first_node->frequencies_list_len)] =
             (MarkovNodeFrequency) {second_node, 1};
+    first_node->frequencies_sum++;
     first_node->frequencies_list_len++;
+    // decayed frequencies may be below 1, so the new one may not be last
+    move_up(first_node->frequencies_list,
+            first_node->frequencies_list_len - 1);
     return true;
 }
 
@@ -101,6 +312,9 @@ void free_database(MarkovChain **markov_chain){
     (*markov_chain)->database->first = NULL;
     (*markov_chain)->database->last = NULL;
     (*markov_chain)->database->size = 0;
+    free((*markov_chain)->buckets); // free the index
+    (*markov_chain)->buckets = NULL;
+    (*markov_chain)->num_buckets = 0;
     free((*markov_chain)->database); // free the database
     (*markov_chain)->database = NULL;
     free(*markov_chain);// free the markov chain
@@ -111,8 +325,15 @@ void free_database(MarkovChain **markov_chain){
  * as described in markov_chain.h
  */
 MarkovNode* get_first_random_node(MarkovChain *markov_chain){
-    int i = get_random_number(markov_chain->database->size);
     Node *cur = markov_chain->database->first;
+    while (cur && markov_chain->is_last(cur->data->data)) {
+        cur = cur->next;
+    }
+    if (cur == NULL) {
+        return NULL; // every state is last
+    }
+    int i = get_random_number(markov_chain->database->size);
+    cur = markov_chain->database->first;
     for (int j = 0; j < i; j++) {
         cur = cur->next;
     }
@@ -130,17 +351,20 @@ MarkovNode* get_first_random_node(MarkovChain *markov_chain){
  * as described in markov_chain.h
  */
 MarkovNode* get_next_random_node(MarkovNode *state_struct_ptr){
-    int sum = 0;
-    for (int j = 0; j < state_struct_ptr->frequencies_list_len; j++) {
-        sum += state_struct_ptr->frequencies_list[j].frequency;
-    }
-    int i = get_random_number(sum);
-    MarkovNodeFrequency *current = state_struct_ptr->frequencies_list;
-    while (i >= current->frequency) {
-        i -= current->frequency;
-        current++;
+    if (state_struct_ptr->frequencies_list_len == 0 ||
+        state_struct_ptr->frequencies_sum <= 0) {
+        return NULL;
     }
-    return current->markov_node;
+    frequency_t i = get_random_frequency(state_struct_ptr->frequencies_sum);
+    return find_successor(state_struct_ptr,
+                          state_struct_ptr->frequencies_list_len, i);
+}
+
+/**
+ * as described in markov_chain.h
+ */
+void advance_epoch(MarkovChain *markov_chain) {
+    markov_chain->epoch++;
 }
 
 /**
@@ -150,10 +374,16 @@ void generate_tweet(MarkovChain *markov_chain, MarkovNode *
 first_node, int max_length){
     if (first_node == NULL) {
         first_node = get_first_random_node(markov_chain);
+        if (first_node == NULL) {
+            return;
+        }
     }
     markov_chain->print_func(first_node->data);
     for (int i = 1; i < max_length; i++) {
         MarkovNode *next_node = get_next_random_node(first_node);
+        if (next_node == NULL) { // no successors
+            break;
+        }
         markov_chain->print_func(next_node->data);
         if (markov_chain->is_last(next_node->data)) {//the end
             break;
@@ -162,6 +392,1305 @@ first_node, int max_length){
     }
 }
 
+/**
+ * as described in markov_chain.h
+ */
+MarkovNode* get_next_decoded_node(MarkovNode *state_struct_ptr,
+                                  const DecodingParams *params) {
+    MarkovNodeFrequency *list = state_struct_ptr->frequencies_list;
+    int len = state_struct_ptr->frequencies_list_len;
+    if (len == 0) {
+        return NULL;
+    }
+    if (params->top_k > 0 && params->top_k < len) {
+        len = params->top_k;
+    }
+    if (params->temperature <= 0 || len == 1 || list[0].frequency <= 0) {
+        return list[0].markov_node; // greedy
+    }
+    if (params->temperature == 1) {
+        frequency_t sum = 0;
+        for (int j = 0; j < len; j++) {
+            sum += list[j].frequency;
+        }
+        if (sum <= 0) {
+            return list[0].markov_node;
+        }
+        return find_successor(state_struct_ptr, len,
+                              get_random_frequency(sum));
+    }
+    // scale relative to the most frequent successor to avoid overflow
+    double exponent = 1 / params->temperature, sum = 0;
+    for (int j = 0; j < len; j++) {
+        sum += pow((double) list[j].frequency / list[0].frequency, exponent);
+    }
+    double r = get_random_unit(NULL) * sum;
+    for (int j = 0; j < len - 1; j++) {
+        r -= pow((double) list[j].frequency / list[0].frequency, exponent);
+        if (r < 0) {
+            return list[j].markov_node;
+        }
+    }
+    return list[len - 1].markov_node;
+}
+
+/**
+ * as described in markov_chain.h
+ */
+void generate_decoded_tweet(MarkovChain *markov_chain, MarkovNode *first_node,
+                            int max_length, const DecodingParams *params) {
+    if (first_node == NULL) {
+        first_node = get_first_random_node(markov_chain);
+        if (first_node == NULL) {
+            return;
+        }
+    }
+    markov_chain->print_func(first_node->data);
+    for (int i = 1; i < max_length; i++) {
+        MarkovNode *next_node = get_next_decoded_node(first_node, params);
+        if (next_node == NULL) { // no successors
+            break;
+        }
+        markov_chain->print_func(next_node->data);
+        if (markov_chain->is_last(next_node->data)) {//the end
+            break;
+        }
+        first_node = next_node;
+    }
+}
+
+/**
+ * A candidate extension of a beam: the beam at index parent followed by
+ * next, or the beam itself if next is NULL.
+ */
+typedef struct BeamCandidate {
+    int parent;
+    MarkovNode *next;
+    double log_prob;
+} BeamCandidate;
+
+/**
+ * Push a candidate to a bounded min-heap of capacity candidates, ordered by
+ * log_prob. When the heap is full the candidate replaces the least probable
+ * one, if it is more probable.
+ * @return true if the candidate was kept, else false
+ */
+static bool push_candidate(BeamCandidate *heap, int *size, int capacity,
+                           BeamCandidate candidate) {
+    int i;
+    if (*size < capacity) {
+        i = (*size)++;
+        while (i > 0 && heap[(i - 1) / 2].log_prob > candidate.log_prob) {
+            heap[i] = heap[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+        heap[i] = candidate;
+        return true;
+    }
+    if (candidate.log_prob <= heap[0].log_prob) {
+        return false;
+    }
+    i = 0;
+    while (2 * i + 1 < *size) {
+        int child = 2 * i + 1;
+        if (child + 1 < *size &&
+            heap[child + 1].log_prob < heap[child].log_prob) {
+            child++;
+        }
+        if (heap[child].log_prob >= candidate.log_prob) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = candidate;
+    return true;
+}
+
+/**
+ * Check whether a beam can't be extended any further.
+ */
+static bool is_beam_finished(MarkovChain *markov_chain, BeamSequence *beam,
+                             int max_length) {
+    MarkovNode *last = beam->states[beam->length - 1];
+    return beam->length == max_length || markov_chain->is_last(last->data) ||
+           last->frequencies_list_len == 0 || last->frequencies_sum <= 0;
+}
+
+/**
+ * as described in markov_chain.h
+ */
+BeamSequence *beam_search(MarkovChain *markov_chain, MarkovNode *first_node,
+                          int max_length, int beam_width,
+                          int *num_sequences) {
+    *num_sequences = 0;
+    if (max_length < 1 || beam_width < 1) {
+        return NULL;
+    }
+    if (first_node == NULL) {
+        first_node = get_first_random_node(markov_chain);
+        if (first_node == NULL) {
+            return NULL;
+        }
+    }
+    // all buffers are allocated once, nothing is allocated per step
+    BeamSequence *beams = malloc(sizeof(BeamSequence) * 2 * beam_width);
+    MarkovNode **paths = malloc(sizeof(MarkovNode *) * 2 * beam_width *
+                                max_length);
+    BeamCandidate *heap = malloc(sizeof(BeamCandidate) * beam_width);
+    if (beams == NULL || paths == NULL || heap == NULL) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        free(beams);
+        free(paths);
+        free(heap);
+        return NULL;
+    }
+    for (int b = 0; b < 2 * beam_width; b++) {
+        beams[b].states = paths + b * max_length;
+    }
+    BeamSequence *current = beams, *next = beams + beam_width;
+    current[0].states[0] = first_node;
+    current[0].length = 1;
+    current[0].log_prob = 0;
+    int num_current = 1;
+    bool extended = true;
+    while (extended) {
+        extended = false;
+        int size = 0;
+        for (int b = 0; b < num_current; b++) {
+            BeamSequence *beam = &current[b];
+            if (is_beam_finished(markov_chain, beam, max_length)) {
+                push_candidate(heap, &size, beam_width,
+                               (BeamCandidate) {b, NULL, beam->log_prob});
+                continue;
+            }
+            MarkovNode *last = beam->states[beam->length - 1];
+            double sum = (double) last->frequencies_sum;
+            // successors are sorted by descending frequency, so once one is
+            // rejected all the following ones would be too
+            for (int j = 0; j < last->frequencies_list_len; j++) {
+                MarkovNodeFrequency *edge = &last->frequencies_list[j];
+                double log_prob = beam->log_prob +
+                                  log(edge->frequency / sum);
+                if (!push_candidate(heap, &size, beam_width,
+                                    (BeamCandidate) {b, edge->markov_node,
+                                                     log_prob})) {
+                    break;
+                }
+            }
+        }
+        for (int i = 0; i < size; i++) {
+            BeamSequence *parent = &current[heap[i].parent];
+            for (int j = 0; j < parent->length; j++) {
+                next[i].states[j] = parent->states[j];
+            }
+            next[i].length = parent->length;
+            next[i].log_prob = heap[i].log_prob;
+            if (heap[i].next != NULL) {
+                next[i].states[next[i].length++] = heap[i].next;
+                extended = true;
+            }
+        }
+        BeamSequence *temp = current;
+        current = next;
+        next = temp;
+        num_current = size;
+    }
+    free(heap);
+    BeamSequence *result = malloc(sizeof(BeamSequence) * num_current);
+    if (result == NULL) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        free(beams);
+        free(paths);
+        return NULL;
+    }
+    for (int i = 0; i < num_current; i++) { // insertion sort, most probable
+        int j = i;
+        while (j > 0 && result[j - 1].log_prob < current[i].log_prob) {
+            result[j] = result[j - 1];
+            j--;
+        }
+        result[j] = current[i];
+    }
+    for (int i = 0; i < num_current; i++) {
+        MarkovNode **states = malloc(sizeof(MarkovNode *) * result[i].length);
+        if (states == NULL) {
+            printf(ALLOCATION_ERROR_MASSAGE);
+            free_beam_sequences(result, i);
+            free(beams);
+            free(paths);
+            return NULL;
+        }
+        for (int j = 0; j < result[i].length; j++) {
+            states[j] = result[i].states[j];
+        }
+        result[i].states = states;
+    }
+    free(beams);
+    free(paths);
+    *num_sequences = num_current;
+    return result;
+}
+
+/**
+ * as described in markov_chain.h
+ */
+void free_beam_sequences(BeamSequence *sequences, int num_sequences) {
+    for (int i = 0; i < num_sequences; i++) {
+        free(sequences[i].states);
+    }
+    free(sequences);
+}
+
+/**
+ * Build the reverse transition graph in CSR form: the predecessors of the
+ * state with index i are preds[offsets[i]] .. preds[offsets[i + 1] - 1].
+ * Transitions of frequency 0 can't be sampled, so they are left out.
+ * @param markov_chain
+ * @param offsets output array of database size + 1 entries
+ * @param preds output array of predecessors
+ * @return true on success, false in case of allocation error
+ */
+static bool build_predecessors(MarkovChain *markov_chain, int **offsets,
+                               MarkovNode ***preds) {
+    int size = markov_chain->database->size;
+    *offsets = calloc(size + 1, sizeof(int));
+    if (*offsets == NULL) {
+        return false;
+    }
+    Node *current;
+    for (current = markov_chain->database->first; current;
+         current = current->next) {
+        MarkovNode *node = current->data;
+        for (int j = 0; j < node->frequencies_list_len; j++) {
+            if (node->frequencies_list[j].frequency > 0) {
+                (*offsets)[node->frequencies_list[j].markov_node->index +
+                           1]++;
+            }
+        }
+    }
+    for (int i = 0; i < size; i++) {
+        (*offsets)[i + 1] += (*offsets)[i];
+    }
+    *preds = malloc(sizeof(MarkovNode *) * ((*offsets)[size] + 1));
+    int *fill = malloc(sizeof(int) * (size + 1));
+    if (*preds == NULL || fill == NULL) {
+        free(*offsets);
+        free(*preds);
+        free(fill);
+        return false;
+    }
+    for (int i = 0; i < size; i++) {
+        fill[i] = (*offsets)[i];
+    }
+    for (current = markov_chain->database->first; current;
+         current = current->next) {
+        MarkovNode *node = current->data;
+        for (int j = 0; j < node->frequencies_list_len; j++) {
+            int to = node->frequencies_list[j].markov_node->index;
+            if (node->frequencies_list[j].frequency > 0) {
+                (*preds)[fill[to]++] = node;
+            }
+        }
+    }
+    free(fill);
+    return true;
+}
+
+/**
+ * Breadth-first search over the reverse graph, from every state whose
+ * distance is 0 in dist. Last states are never expanded as intermediate
+ * states, since a walk stops on them.
+ * @param markov_chain
+ * @param offsets, preds reverse graph built by build_predecessors
+ * @param dist distance per state: 0 for sources, UNREACHABLE otherwise.
+ * Filled with the minimal number of steps to any source.
+ * @return true on success, false in case of allocation error
+ */
+static bool reverse_bfs(MarkovChain *markov_chain, int *offsets,
+                        MarkovNode **preds, int *dist) {
+    int size = markov_chain->database->size;
+    int *queue = malloc(sizeof(int) * (size + 1));
+    if (queue == NULL) {
+        return false;
+    }
+    int head = 0, tail = 0;
+    for (int i = 0; i < size; i++) {
+        if (dist[i] == 0) {
+            queue[tail++] = i;
+        }
+    }
+    while (head < tail) {
+        int to = queue[head++];
+        for (int j = offsets[to]; j < offsets[to + 1]; j++) {
+            MarkovNode *from = preds[j];
+            if (dist[from->index] == UNREACHABLE &&
+                !markov_chain->is_last(from->data)) {
+                dist[from->index] = dist[to] + 1;
+                queue[tail++] = from->index;
+            }
+        }
+    }
+    free(queue);
+    return true;
+}
+
+/**
+ * as described in markov_chain.h
+ */
+bool prepare_constraints(MarkovChain *markov_chain,
+                         MarkovConstraints *constraints) {
+    int size = markov_chain->database->size;
+    free_constraints(constraints); // tables of an earlier preparation
+    if (constraints->required != NULL) {
+        Node *required = get_node_from_database(markov_chain,
+                                                constraints->required);
+        if (required == NULL) {
+            return false;
+        }
+        constraints->required_node = required->data;
+    }
+    int *offsets;
+    MarkovNode **preds;
+    if (!build_predecessors(markov_chain, &offsets, &preds)) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        return false;
+    }
+    constraints->dist_to_last = malloc(sizeof(int) * (size + 1));
+    if (constraints->required_node != NULL) {
+        constraints->dist_to_required = malloc(sizeof(int) * (size + 1));
+    }
+    bool success = constraints->dist_to_last != NULL &&
+            (constraints->required_node == NULL ||
+             constraints->dist_to_required != NULL);
+    if (success) {
+        for (Node *cur = markov_chain->database->first; cur;
+             cur = cur->next) {
+            constraints->dist_to_last[cur->data->index] =
+                    markov_chain->is_last(cur->data->data) ? 0 : UNREACHABLE;
+        }
+        success = reverse_bfs(markov_chain, offsets, preds,
+                              constraints->dist_to_last);
+    }
+    if (success && constraints->required_node != NULL) {
+        for (int i = 0; i < size; i++) {
+            constraints->dist_to_required[i] = UNREACHABLE;
+        }
+        constraints->dist_to_required[constraints->required_node->index] = 0;
+        success = reverse_bfs(markov_chain, offsets, preds,
+                              constraints->dist_to_required);
+    }
+    free(offsets);
+    free(preds);
+    if (!success) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        free_constraints(constraints);
+    }
+    return success;
+}
+
+/**
+ * as described in markov_chain.h
+ */
+void free_constraints(MarkovConstraints *constraints) {
+    free(constraints->dist_to_last);
+    constraints->dist_to_last = NULL;
+    free(constraints->dist_to_required);
+    constraints->dist_to_required = NULL;
+    constraints->required_node = NULL;
+}
+
+/**
+ * Check whether a sentence whose length-th state is node can still be
+ * completed into a sentence of at most max_length states that satisfies
+ * the constraints.
+ * @param seen_required true if the required state appeared before node
+ * @return true if the sentence can be completed, else false
+ */
+static bool is_feasible(MarkovChain *markov_chain,
+                        MarkovConstraints *constraints, MarkovNode *node,
+                        int length, int max_length, bool seen_required) {
+    int remaining = max_length - length;
+    seen_required = seen_required || node == constraints->required_node;
+    if (remaining < 0) {
+        return false;
+    }
+    if (markov_chain->is_last(node->data)) {
+        return seen_required;
+    }
+    if (!seen_required) {
+        int to_required = constraints->dist_to_required[node->index];
+        if (to_required == UNREACHABLE) {
+            return false;
+        }
+        if (!constraints->must_end) {
+            return to_required <= remaining;
+        }
+        int to_last =
+                constraints->dist_to_last[constraints->required_node->index];
+        return to_last != UNREACHABLE && to_required + to_last <= remaining;
+    }
+    if (!constraints->must_end) {
+        return true;
+    }
+    int to_last = constraints->dist_to_last[node->index];
+    return to_last != UNREACHABLE && to_last <= remaining;
+}
+
+/**
+ * Choose randomly the next state among the successors of node that keep
+ * the sentence feasible, depend on their occurrence frequency.
+ * @return the chosen state, NULL if no successor is feasible
+ */
+static MarkovNode *get_next_constrained_node(MarkovChain *markov_chain,
+                                             MarkovConstraints *constraints,
+                                             MarkovNode *node, int length,
+                                             int max_length,
+                                             bool seen_required) {
+    frequency_t sum = 0;
+    for (int j = 0; j < node->frequencies_list_len; j++) {
+        if (is_feasible(markov_chain, constraints,
+                        node->frequencies_list[j].markov_node, length + 1,
+                        max_length, seen_required)) {
+            sum += node->frequencies_list[j].frequency;
+        }
+    }
+    if (sum <= 0) {
+        return NULL;
+    }
+    frequency_t i = get_random_frequency(sum);
+    MarkovNode *chosen = NULL;
+    for (int j = 0; j < node->frequencies_list_len; j++) {
+        MarkovNodeFrequency *current = &node->frequencies_list[j];
+        if (is_feasible(markov_chain, constraints, current->markov_node,
+                        length + 1, max_length, seen_required)) {
+            chosen = current->markov_node; // last feasible, for rounding
+            if (i < current->frequency) {
+                return chosen;
+            }
+            i -= current->frequency;
+        }
+    }
+    return chosen;
+}
+
+/**
+ * Choose randomly a first state that is not last and from which the
+ * constraints can be satisfied.
+ * @return the chosen state, NULL if there is none
+ */
+static MarkovNode *get_first_constrained_node(MarkovChain *markov_chain,
+                                              MarkovConstraints *constraints,
+                                              int max_length) {
+    int count = 0;
+    Node *cur;
+    for (cur = markov_chain->database->first; cur; cur = cur->next) {
+        if (!markov_chain->is_last(cur->data->data) &&
+            is_feasible(markov_chain, constraints, cur->data, 1, max_length,
+                        constraints->required_node == NULL)) {
+            count++;
+        }
+    }
+    if (count == 0) {
+        return NULL;
+    }
+    int i = get_random_number(count);
+    for (cur = markov_chain->database->first; cur; cur = cur->next) {
+        if (!markov_chain->is_last(cur->data->data) &&
+            is_feasible(markov_chain, constraints, cur->data, 1, max_length,
+                        constraints->required_node == NULL) && i-- == 0) {
+            break;
+        }
+    }
+    return cur->data;
+}
+
+/**
+ * Check whether the given prefix is a walk in the chain that can be
+ * completed under the constraints.
+ * @param seen_required set to true if the required state is in the prefix
+ * @return the last state of the prefix, NULL if it can't be completed
+ */
+static MarkovNode *check_prefix(MarkovChain *markov_chain,
+                                MarkovConstraints *constraints,
+                                int max_length, bool *seen_required) {
+    MarkovNode *current = NULL;
+    bool seen_before = *seen_required;
+    for (int i = 0; i < constraints->prefix_len; i++) {
+        Node *node = get_node_from_database(markov_chain,
+                                            constraints->prefix[i]);
+        if (node == NULL || i >= max_length) {
+            return NULL;
+        }
+        if (current != NULL) {
+            if (markov_chain->is_last(current->data)) {
+                return NULL;
+            }
+            int j = 0;
+            while (j < current->frequencies_list_len &&
+                   current->frequencies_list[j].markov_node != node->data) {
+                j++;
+            }
+            if (j == current->frequencies_list_len) {
+                return NULL; // not a transition of the chain
+            }
+            seen_before = seen_before ||
+                          current == constraints->required_node;
+        }
+        current = node->data;
+    }
+    if (!is_feasible(markov_chain, constraints, current,
+                     constraints->prefix_len, max_length, seen_before)) {
+        return NULL;
+    }
+    *seen_required = seen_before || current == constraints->required_node;
+    return current;
+}
+
+/**
+ * as described in markov_chain.h
+ */
+int generate_constrained_tweet(MarkovChain *markov_chain,
+                               MarkovConstraints *constraints,
+                               int max_length) {
+    bool seen_required = constraints->required == NULL;
+    if (max_length < 1 ||
+        (!seen_required && constraints->required_node == NULL)) {
+        return 0; // required state is not in the chain
+    }
+    MarkovNode *current;
+    int length;
+    if (constraints->prefix_len > 0) {
+        current = check_prefix(markov_chain, constraints, max_length,
+                               &seen_required);
+    } else {
+        current = get_first_constrained_node(markov_chain, constraints,
+                                             max_length);
+        seen_required = seen_required ||
+                        current == constraints->required_node;
+    }
+    // printed only once it satisfies the constraints
+    MarkovNode **sentence = current != NULL ?
+                            malloc(sizeof(MarkovNode *) * max_length) : NULL;
+    if (sentence == NULL) {
+        if (current != NULL) {
+            printf(ALLOCATION_ERROR_MASSAGE);
+        }
+        return 0;
+    }
+    for (length = 0; length < constraints->prefix_len; length++) {
+        sentence[length] = get_node_from_database(
+                markov_chain, constraints->prefix[length])->data;
+    }
+    if (length == 0) {
+        sentence[length++] = current;
+    }
+    while (length < max_length && !markov_chain->is_last(current->data)) {
+        MarkovNode *next_node = get_next_constrained_node(
+                markov_chain, constraints, current, length, max_length,
+                seen_required);
+        if (next_node == NULL) { // dead end
+            break;
+        }
+        sentence[length++] = next_node;
+        seen_required = seen_required ||
+                        next_node == constraints->required_node;
+        current = next_node;
+    }
+    bool satisfied = seen_required && (!constraints->must_end ||
+                                       markov_chain->is_last(current->data));
+    for (int i = 0; satisfied && i < length; i++) {
+        markov_chain->print_func(sentence[i]->data);
+    }
+    free(sentence);
+    return satisfied ? length : 0;
+}
+
+/**
+ * as described in markov_chain.h
+ */
+double score_sequence(MarkovChain *markov_chain, void **sequence, int length,
+                      double smoothing) {
+    double log_likelihood = 0;
+    double vocabulary = smoothing * markov_chain->database->size;
+    Node *from = length > 0 ?
+                 get_node_from_database(markov_chain, sequence[0]) : NULL;
+    for (int i = 1; i < length; i++) {
+        Node *to = get_node_from_database(markov_chain, sequence[i]);
+        double count = 0, total = 0;
+        if (from != NULL) {
+            MarkovNode *node = from->data;
+            total = (double) node->frequencies_sum;
+            for (int j = 0; to != NULL && j < node->frequencies_list_len;
+                 j++) {
+                if (node->frequencies_list[j].markov_node == to->data) {
+                    count = (double) node->frequencies_list[j].frequency;
+                    break;
+                }
+            }
+        }
+        // an empty chain gives no probability to any transition, even
+        // with smoothing
+        if (count + smoothing <= 0 || total + vocabulary <= 0) {
+            return -INFINITY;
+        }
+        log_likelihood += log((count + smoothing) / (total + vocabulary));
+        from = to;
+    }
+    return log_likelihood;
+}
+
+/**
+ * as described in markov_chain.h
+ */
+double get_perplexity(MarkovChain *markov_chain, void **sequence, int length,
+                      double smoothing) {
+    if (length < 2) {
+        return 1;
+    }
+    return exp(-score_sequence(markov_chain, sequence, length, smoothing) /
+               (length - 1));
+}
+
+/**
+ * A contiguous share of the sequences scored by one thread.
+ */
+typedef struct ScoringTask {
+    MarkovChain *markov_chain;
+    void ***sequences;
+    const int *lengths;
+    int count;
+    double smoothing;
+    double *log_likelihoods;
+} ScoringTask;
+
+/**
+ * Score all sequences of the given ScoringTask.
+ */
+static void *run_scoring_task(void *arg) {
+    ScoringTask *task = arg;
+    for (int i = 0; i < task->count; i++) {
+        task->log_likelihoods[i] = score_sequence(task->markov_chain,
+                                                  task->sequences[i],
+                                                  task->lengths[i],
+                                                  task->smoothing);
+    }
+    return NULL;
+}
+
+/**
+ * as described in markov_chain.h
+ */
+void score_sequences(MarkovChain *markov_chain, void ***sequences,
+                     const int *lengths, int count, double smoothing,
+                     int num_threads, double *log_likelihoods) {
+    if (num_threads > count) {
+        num_threads = count;
+    }
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+    ScoringTask *tasks = malloc(sizeof(ScoringTask) * num_threads);
+    pthread_t *threads = malloc(sizeof(pthread_t) * num_threads);
+    bool *started = calloc(num_threads, sizeof(bool));
+    if (tasks == NULL || threads == NULL || started == NULL) {
+        free(tasks);
+        free(threads);
+        free(started);
+        ScoringTask task = {markov_chain, sequences, lengths, count,
+                            smoothing, log_likelihoods};
+        run_scoring_task(&task);
+        return;
+    }
+    for (int t = 0; t < num_threads; t++) {
+        int begin = (int) ((long) count * t / num_threads);
+        int end = (int) ((long) count * (t + 1) / num_threads);
+        tasks[t] = (ScoringTask) {markov_chain, sequences + begin,
+                                  lengths + begin, end - begin, smoothing,
+                                  log_likelihoods + begin};
+        // the first share runs on the calling thread
+        started[t] = t > 0 && pthread_create(&threads[t], NULL,
+                                             run_scoring_task,
+                                             &tasks[t]) == 0;
+    }
+    for (int t = 0; t < num_threads; t++) {
+        if (started[t]) {
+            pthread_join(threads[t], NULL);
+        } else {
+            run_scoring_task(&tasks[t]);
+        }
+    }
+    free(tasks);
+    free(threads);
+    free(started);
+}
+
+/**
+ * Sort items by the data of their states with a bottom-up merge sort.
+ * @param items array to sort
+ * @param size number of items
+ * @param comp_func function comparing the data of two states
+ * @return true on success, false in case of allocation error
+ */
+static bool sort_by_data(MarkovNodeFrequency *items, int size,
+                         comp comp_func) {
+    MarkovNodeFrequency *buffer = malloc(sizeof(MarkovNodeFrequency) *
+                                         (size + 1));
+    if (buffer == NULL) {
+        return false;
+    }
+    MarkovNodeFrequency *from = items, *to = buffer;
+    for (int width = 1; width < size; width *= 2) {
+        for (int low = 0; low < size; low += 2 * width) {
+            int mid = MIN(low + width, size), high = MIN(low + 2 * width, size);
+            int i = low, j = mid, k = low;
+            while (i < mid && j < high) {
+                if (comp_func(from[j].markov_node->data,
+                              from[i].markov_node->data) < 0) {
+                    to[k++] = from[j++];
+                } else {
+                    to[k++] = from[i++];
+                }
+            }
+            while (i < mid) {
+                to[k++] = from[i++];
+            }
+            while (j < high) {
+                to[k++] = from[j++];
+            }
+        }
+        MarkovNodeFrequency *temp = from;
+        from = to;
+        to = temp;
+    }
+    if (from != items) {
+        for (int i = 0; i < size; i++) {
+            items[i] = from[i];
+        }
+    }
+    free(buffer);
+    return true;
+}
+
+/**
+ * Get the states of the chain sorted by their data, each paired with the
+ * sum of the frequencies of its transitions, decayed to the current epoch.
+ * @param markov_chain
+ * @return dynamically allocated array of database size states, NULL in
+ * case of allocation error
+ */
+static MarkovNodeFrequency *get_sorted_states(MarkovChain *markov_chain) {
+    int size = markov_chain->database->size;
+    MarkovNodeFrequency *states = malloc(sizeof(MarkovNodeFrequency) *
+                                         (size + 1));
+    if (states == NULL) {
+        return NULL;
+    }
+    int i = 0;
+    for (Node *cur = markov_chain->database->first; cur; cur = cur->next) {
+        states[i++] = (MarkovNodeFrequency) {
+                cur->data, get_decayed(markov_chain, cur->data,
+                                       cur->data->frequencies_sum)};
+    }
+    if (!sort_by_data(states, size, markov_chain->comp_func)) {
+        free(states);
+        return NULL;
+    }
+    return states;
+}
+
+/**
+ * Allocate a new empty chain with the functions of the given chain.
+ * @return the new chain, NULL in case of allocation error
+ */
+static MarkovChain *create_chain_like(MarkovChain *model) {
+    MarkovChain *markov_chain = malloc(sizeof(MarkovChain));
+    LinkedList *database = malloc(sizeof(LinkedList));
+    if (markov_chain == NULL || database == NULL) {
+        free(markov_chain);
+        free(database);
+        return NULL;
+    }
+    *database = (LinkedList) {NULL, NULL, 0};
+    *markov_chain = *model;
+    markov_chain->database = database;
+    markov_chain->buckets = NULL;
+    markov_chain->num_buckets = 0;
+    return markov_chain;
+}
+
+/**
+ * A weighted transition between states of the merged chain, by index.
+ */
+typedef struct MergeEdge {
+    int from;
+    int to;
+    double weight; // weight of the chain of the transition
+    frequency_t frequency; // decayed frequency of the transition
+} MergeEdge;
+
+/**
+ * qsort comparator of MergeEdge by successor index.
+ */
+static int compare_edges_by_to(const void *a, const void *b) {
+    return ((const MergeEdge *) a)->to - ((const MergeEdge *) b)->to;
+}
+
+/**
+ * qsort comparator of MarkovNodeFrequency by descending frequency, then by
+ * index of the successor.
+ */
+static int compare_by_frequency(const void *a, const void *b) {
+    const MarkovNodeFrequency *first = a, *second = b;
+    if (first->frequency != second->frequency) {
+        return first->frequency < second->frequency ? 1 : -1;
+    }
+    return first->markov_node->index - second->markov_node->index;
+}
+
+/**
+ * Add the states of the given chains to the empty merged chain, by merging
+ * the sorted lists of states, and map every state of every chain to the
+ * merged state with the same data.
+ * @return true on success, false in case of allocation error
+ */
+static bool merge_states(MarkovChain **chains, int num_chains,
+                         MarkovNodeFrequency **sorted, MarkovNode ***map,
+                         MarkovChain *merged) {
+    int *pos = calloc(num_chains, sizeof(int));
+    if (pos == NULL) {
+        return false;
+    }
+    while (true) {
+        int min = -1;
+        for (int c = 0; c < num_chains; c++) {
+            if (pos[c] < chains[c]->database->size &&
+                (min == -1 ||
+                 merged->comp_func(sorted[c][pos[c]].markov_node->data,
+                                   sorted[min][pos[min]].markov_node->data)
+                 < 0)) {
+                min = c;
+            }
+        }
+        if (min == -1) {
+            break;
+        }
+        void *data = sorted[min][pos[min]].markov_node->data;
+        Node *node = append_to_database(merged, data);
+        if (node == NULL) {
+            free(pos);
+            return false;
+        }
+        for (int c = 0; c < num_chains; c++) {
+            if (pos[c] < chains[c]->database->size &&
+                merged->comp_func(sorted[c][pos[c]].markov_node->data,
+                                  data) == 0) {
+                map[c][sorted[c][pos[c]].markov_node->index] = node->data;
+                pos[c]++;
+            }
+        }
+    }
+    free(pos);
+    return true;
+}
+
+/**
+ * Set the frequencies lists of the merged chain from its weighted
+ * transitions, grouped by state index with a counting sort.
+ * @param merged the merged chain
+ * @param edges the weighted transitions, in any order
+ * @param num_edges number of transitions
+ * @return true on success, false in case of allocation error
+ */
+static bool merge_edges(MarkovChain *merged, MergeEdge *edges,
+                        int num_edges) {
+    int size = merged->database->size;
+    MarkovNode **states = malloc(sizeof(MarkovNode *) * (size + 1));
+    int *offsets = calloc(size + 1, sizeof(int));
+    MergeEdge *grouped = malloc(sizeof(MergeEdge) * (num_edges + 1));
+    bool success = states != NULL && offsets != NULL && grouped != NULL;
+    if (success) {
+        for (Node *cur = merged->database->first; cur; cur = cur->next) {
+            states[cur->data->index] = cur->data;
+        }
+        for (int i = 0; i < num_edges; i++) {
+            offsets[edges[i].from + 1]++;
+        }
+        for (int i = 0; i + 1 < size; i++) {
+            offsets[i + 1] += offsets[i];
+        }
+        for (int i = 0; i < num_edges; i++) {
+            grouped[offsets[edges[i].from]++] = edges[i];
+        }
+    }
+    for (int i = 0, begin = 0; success && i < size; i++) {
+        int end = offsets[i]; // shifted to the end of state i by the fill
+        qsort(grouped + begin, end - begin, sizeof(MergeEdge),
+              compare_edges_by_to);
+        MarkovNode *node = states[i];
+        node->frequencies_list = malloc(sizeof(MarkovNodeFrequency) *
+                                        (end - begin + 1));
+        if (node->frequencies_list == NULL) {
+            success = false;
+            break;
+        }
+        for (int j = begin; j < end;) {
+            frequency_t frequency = 0; // frequencies of weight 1, exact
+            double weighted = 0; // frequencies of other weights
+            int to = grouped[j].to;
+            for (; j < end && grouped[j].to == to; j++) {
+                if (grouped[j].weight == 1) {
+                    frequency += grouped[j].frequency;
+                } else {
+                    weighted += grouped[j].weight * grouped[j].frequency;
+                }
+            }
+#ifdef MARKOV_FRACTIONAL_FREQUENCIES
+            frequency += weighted;
+#else
+            if (weighted > 0) {
+                frequency += (frequency_t) (weighted + 0.5);
+            }
+#endif
+            if (frequency > 0) {
+                node->frequencies_list[node->frequencies_list_len++] =
+                        (MarkovNodeFrequency) {states[to], frequency};
+                node->frequencies_sum += frequency;
+            }
+        }
+        qsort(node->frequencies_list, node->frequencies_list_len,
+              sizeof(MarkovNodeFrequency), compare_by_frequency);
+        begin = end;
+    }
+    free(states);
+    free(offsets);
+    free(grouped);
+    return success;
+}
+
+/**
+ * as described in markov_chain.h
+ */
+MarkovChain *merge_chains(MarkovChain **chains, const double *weights,
+                          int num_chains) {
+    MarkovChain *merged = create_chain_like(chains[0]);
+    MarkovNodeFrequency **sorted = calloc(num_chains,
+                                          sizeof(MarkovNodeFrequency *));
+    MarkovNode ***map = calloc(num_chains, sizeof(MarkovNode **));
+    MergeEdge *edges = NULL;
+    bool success = merged != NULL && sorted != NULL && map != NULL;
+    int num_edges = 0;
+    for (int c = 0; success && c < num_chains; c++) {
+        sorted[c] = get_sorted_states(chains[c]);
+        map[c] = malloc(sizeof(MarkovNode *) *
+                        (chains[c]->database->size + 1));
+        success = sorted[c] != NULL && map[c] != NULL;
+        for (Node *cur = chains[c]->database->first; success && cur;
+             cur = cur->next) {
+            num_edges += cur->data->frequencies_list_len;
+        }
+    }
+    success = success && merge_states(chains, num_chains, sorted, map,
+                                      merged);
+    if (success) {
+        edges = malloc(sizeof(MergeEdge) * (num_edges + 1));
+        success = edges != NULL;
+    }
+    if (success) {
+        int i = 0;
+        for (int c = 0; c < num_chains; c++) {
+            double weight = weights != NULL ? weights[c] : 1;
+            for (Node *cur = chains[c]->database->first; cur;
+                 cur = cur->next) {
+                MarkovNode *node = cur->data;
+                for (int j = 0; j < node->frequencies_list_len; j++) {
+                    MarkovNodeFrequency *edge = &node->frequencies_list[j];
+                    edges[i++] = (MergeEdge) {
+                            map[c][node->index]->index,
+                            map[c][edge->markov_node->index]->index,
+                            weight, get_decayed(chains[c], node,
+                                                edge->frequency)};
+                }
+            }
+        }
+        success = merge_edges(merged, edges, num_edges);
+    }
+    for (int c = 0; sorted != NULL && map != NULL && c < num_chains; c++) {
+        free(sorted[c]);
+        free(map[c]);
+    }
+    free(sorted);
+    free(map);
+    free(edges);
+    if (!success) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        if (merged != NULL) {
+            free_database(&merged);
+        }
+    }
+    return merged;
+}
+
+/**
+ * as described in markov_chain.h
+ */
+void get_decay_weights(double decay, int num_chains, double *weights) {
+    double weight = 1;
+    for (int i = num_chains - 1; i >= 0; i--) {
+        weights[i] = weight;
+        weight *= decay;
+    }
+}
+
+/**
+ * Insert an entry to a bounded array of entries sorted by descending
+ * change of probability. Unchanged entries are ignored.
+ */
+static void insert_diff(ChainDiff *entries, int *size, int max_entries,
+                        ChainDiff entry) {
+    double change = fabs(entry.prob_b - entry.prob_a);
+    if (change == 0 || max_entries <= 0) {
+        return;
+    }
+    int i;
+    if (*size < max_entries) {
+        i = (*size)++;
+    } else if (change > fabs(entries[max_entries - 1].prob_b -
+                             entries[max_entries - 1].prob_a)) {
+        i = max_entries - 1;
+    } else {
+        return;
+    }
+    while (i > 0 && fabs(entries[i - 1].prob_b - entries[i - 1].prob_a) <
+                    change) {
+        entries[i] = entries[i - 1];
+        i--;
+    }
+    entries[i] = entry;
+}
+
+/**
+ * Get a copy of the frequencies list of a state sorted by data.
+ * @param state the state paired with its total frequency, may be NULL
+ * @param len set to the length of the list
+ * @return dynamically allocated list, NULL in case of allocation error
+ */
+static MarkovNodeFrequency *get_sorted_transitions(MarkovNodeFrequency *state,
+                                                   comp comp_func,
+                                                   int *len) {
+    *len = state != NULL ? state->markov_node->frequencies_list_len : 0;
+    MarkovNodeFrequency *list = malloc(sizeof(MarkovNodeFrequency) *
+                                       (*len + 1));
+    if (list == NULL) {
+        return NULL;
+    }
+    for (int i = 0; i < *len; i++) {
+        list[i] = state->markov_node->frequencies_list[i];
+    }
+    if (!sort_by_data(list, *len, comp_func)) {
+        free(list);
+        return NULL;
+    }
+    return list;
+}
+
+/**
+ * Add the transitions of a state of the compared chains to the reported
+ * transitions of diff_chains.
+ * @param state_a the state in chain a paired with its total frequency,
+ * NULL if the state is not in chain a
+ * @param state_b the same for chain b
+ * @return true on success, false in case of allocation error
+ */
+static bool diff_transitions(comp comp_func, MarkovNodeFrequency *state_a,
+                             MarkovNodeFrequency *state_b, int max_entries,
+                             ChainDiff *transitions, int *num_transitions) {
+    int len_a, len_b;
+    MarkovNodeFrequency *list_a = get_sorted_transitions(state_a, comp_func,
+                                                         &len_a);
+    MarkovNodeFrequency *list_b = get_sorted_transitions(state_b, comp_func,
+                                                         &len_b);
+    if (list_a == NULL || list_b == NULL) {
+        free(list_a);
+        free(list_b);
+        return false;
+    }
+    void *from = state_a != NULL ? state_a->markov_node->data :
+                 state_b->markov_node->data;
+    int i = 0, j = 0;
+    while (i < len_a || j < len_b) {
+        int order = i == len_a ? 1 : j == len_b ? -1 :
+                    comp_func(list_a[i].markov_node->data,
+                              list_b[j].markov_node->data);
+        ChainDiff entry = {from, NULL, 0, 0};
+        if (order <= 0) {
+            entry.to = list_a[i].markov_node->data;
+            entry.prob_a = (double) list_a[i++].frequency /
+                           state_a->markov_node->frequencies_sum;
+        }
+        if (order >= 0) {
+            entry.to = order == 0 ? entry.to : list_b[j].markov_node->data;
+            entry.prob_b = (double) list_b[j++].frequency /
+                           state_b->markov_node->frequencies_sum;
+        }
+        insert_diff(transitions, num_transitions, max_entries, entry);
+    }
+    free(list_a);
+    free(list_b);
+    return true;
+}
+
+/**
+ * as described in markov_chain.h
+ */
+bool diff_chains(MarkovChain *chain_a, MarkovChain *chain_b, int max_entries,
+                 ChainDiff *states, int *num_states, ChainDiff *transitions,
+                 int *num_transitions) {
+    *num_states = 0;
+    *num_transitions = 0;
+    comp comp_func = chain_a->comp_func;
+    int size_a = chain_a->database->size, size_b = chain_b->database->size;
+    MarkovNodeFrequency *sorted_a = get_sorted_states(chain_a);
+    MarkovNodeFrequency *sorted_b = get_sorted_states(chain_b);
+    bool success = sorted_a != NULL && sorted_b != NULL;
+    double total_a = 0, total_b = 0;
+    for (int i = 0; success && i < size_a; i++) {
+        total_a += sorted_a[i].frequency;
+    }
+    for (int j = 0; success && j < size_b; j++) {
+        total_b += sorted_b[j].frequency;
+    }
+    int i = 0, j = 0;
+    while (success && (i < size_a || j < size_b)) {
+        int order = i == size_a ? 1 : j == size_b ? -1 :
+                    comp_func(sorted_a[i].markov_node->data,
+                              sorted_b[j].markov_node->data);
+        MarkovNodeFrequency *state_a = order <= 0 ? &sorted_a[i++] : NULL;
+        MarkovNodeFrequency *state_b = order >= 0 ? &sorted_b[j++] : NULL;
+        ChainDiff entry = {state_a != NULL ? state_a->markov_node->data :
+                           state_b->markov_node->data, NULL,
+                           state_a != NULL && total_a > 0 ?
+                           (double) state_a->frequency / total_a : 0,
+                           state_b != NULL && total_b > 0 ?
+                           (double) state_b->frequency / total_b : 0};
+        insert_diff(states, num_states, max_entries, entry);
+        success = diff_transitions(comp_func, state_a, state_b, max_entries,
+                                   transitions, num_transitions);
+    }
+    free(sorted_a);
+    free(sorted_b);
+    if (!success) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+    }
+    return success;
+}
+
+/**
+ * as described in markov_chain.h
+ */
+bool chains_equal(MarkovChain *chain_a, MarkovChain *chain_b) {
+    int size = chain_a->database->size;
+    if (size != chain_b->database->size) {
+        return false;
+    }
+    comp comp_func = chain_a->comp_func;
+    MarkovNodeFrequency *sorted_a = get_sorted_states(chain_a);
+    MarkovNodeFrequency *sorted_b = get_sorted_states(chain_b);
+    bool equal = sorted_a != NULL && sorted_b != NULL;
+    for (int i = 0; equal && i < size; i++) {
+        int len_a, len_b;
+        MarkovNodeFrequency *list_a = NULL, *list_b = NULL;
+        equal = comp_func(sorted_a[i].markov_node->data,
+                          sorted_b[i].markov_node->data) == 0 &&
+                sorted_a[i].frequency == sorted_b[i].frequency &&
+                (list_a = get_sorted_transitions(&sorted_a[i], comp_func,
+                                                 &len_a)) != NULL &&
+                (list_b = get_sorted_transitions(&sorted_b[i], comp_func,
+                                                 &len_b)) != NULL &&
+                len_a == len_b;
+        for (int j = 0; equal && j < len_a; j++) {
+            equal = comp_func(list_a[j].markov_node->data,
+                              list_b[j].markov_node->data) == 0 &&
+                    list_a[j].frequency == list_b[j].frequency;
+        }
+        free(list_a);
+        free(list_b);
+    }
+    free(sorted_a);
+    free(sorted_b);
+    return equal;
+}
+
+/**
+ * the function checks the frequencies list of a state of a consistent
+ * database
+ * @param node the state
+ * @param nodes the states of the chain by index
+ * @param size number of states
+ * @param listed zeroed flags by index, zeroed again
+ * @return true if the list is consistent, else false
+ */
+static bool is_list_consistent(MarkovNode *node, MarkovNode **nodes,
+                               int size, bool *listed) {
+    MarkovNodeFrequency *list = node->frequencies_list;
+    frequency_t sum = 0;
+    int j = 0;
+    for (; j < node->frequencies_list_len; j++) {
+        MarkovNode *next = list[j].markov_node;
+        if (next == NULL || next->index < 0 || next->index >= size ||
+            nodes[next->index] != next || listed[next->index] ||
+            (j > 0 && list[j - 1].frequency < list[j].frequency)) {
+            break;
+        }
+        listed[next->index] = true;
+        sum += list[j].frequency;
+    }
+    bool consistent = j == node->frequencies_list_len;
+    for (int k = 0; k < j; k++) {
+        listed[list[k].markov_node->index] = false;
+    }
+#ifdef MARKOV_FRACTIONAL_FREQUENCIES
+    return consistent && fabs(sum - node->frequencies_sum) <= 1e-9 * sum;
+#else
+    return consistent && sum == node->frequencies_sum;
+#endif
+}
+
+/**
+ * as described in markov_chain.h
+ */
+bool is_chain_consistent(MarkovChain *markov_chain) {
+    int size = markov_chain->database->size;
+    MarkovNode **nodes = calloc(size + 1, sizeof(MarkovNode *));
+    bool *listed = calloc(size + 1, sizeof(bool));
+    if (nodes == NULL || listed == NULL) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        free(nodes);
+        free(listed);
+        return false;
+    }
+    int count = 0;
+    bool consistent = true;
+    for (Node *cur = markov_chain->database->first; consistent && cur;
+         cur = cur->next) {
+        int index = cur->data->index;
+        consistent = index >= 0 && index < size && nodes[index] == NULL &&
+                     get_node_from_database(markov_chain,
+                                            cur->data->data) == cur;
+        if (consistent) {
+            nodes[index] = cur->data;
+            count++;
+        }
+    }
+    consistent = consistent && count == size;
+    for (int i = 0; consistent && i < size; i++) {
+        consistent = is_list_consistent(nodes[i], nodes, size, listed);
+    }
+    free(nodes);
+    free(listed);
+    return consistent;
+}
+
 /**
  * as described in markov_chain.h
  */
@@ -5,6 +5,8 @@
 #include <stdio.h>  // For printf(), sscanf()
 #include <stdlib.h> // For exit(), malloc()
 #include <stdbool.h> // for bool
+#include <math.h> // For log(), pow()
+#include <stdint.h> // For uint64_t
 
 #define ALLOCATION_ERROR_MASSAGE \
 "Allocation failure: Failed to allocate new memory\n"
@@ -18,6 +20,17 @@ typedef int (*comp)(void*, void*);
 typedef void(*free_func)(void*);
 typedef void*(*copy)(void*);
 typedef bool(*is_last_func)(void*);
+typedef unsigned long(*hash_func)(void*);
+
+/**
+ * Type of transition frequencies: 64-bit counts, or fractional weights that
+ * can decay over time when MARKOV_FRACTIONAL_FREQUENCIES is defined.
+ */
+#ifdef MARKOV_FRACTIONAL_FREQUENCIES
+typedef double frequency_t;
+#else
+typedef uint64_t frequency_t;
+#endif
 /***************************/
 
 
@@ -30,11 +43,14 @@ typedef struct MarkovNode {
     void* data;
     struct MarkovNodeFrequency *frequencies_list;
     int frequencies_list_len;
+    int index; // position of the node in the chain's database
+    frequency_t frequencies_sum; // sum of the frequencies in the list
+    long epoch; // epoch of the chain the frequencies were last decayed to
 } MarkovNode;
 
 typedef struct MarkovNodeFrequency {
     MarkovNode *markov_node;
-    int frequency;
+    frequency_t frequency;
 } MarkovNodeFrequency;
 
 typedef struct MarkovChain {
@@ -44,25 +60,78 @@ typedef struct MarkovChain {
     free_func free_data;
     copy copy_func;
     is_last_func is_last;
+    hash_func hash; // NULL to look states up by scanning the database
+    Node **buckets; // open addressing index of the database, by hash
+    int num_buckets;
+    double decay; // factor the frequencies are multiplied by every epoch,
+    // only with MARKOV_FRACTIONAL_FREQUENCIES; 1 for no decay
+    long epoch; // current epoch, advanced by advance_epoch
 } MarkovChain;
 
+/**
+ * Constraints for generate_constrained_tweet. Fill prefix, prefix_len,
+ * required and must_end, zero the other fields, then call
+ * prepare_constraints once to compute the lookup tables; the same
+ * constraints may then be used for many sequences.
+ */
+typedef struct MarkovConstraints {
+    void **prefix; // states the sequence must start with, NULL for none
+    int prefix_len;
+    void *required; // state that must appear in the sequence, NULL for none
+    bool must_end; // the sequence must end with a last state
+    /* filled by prepare_constraints */
+    MarkovNode *required_node;
+    int *dist_to_last; // min steps from each state to a last state
+    int *dist_to_required; // min steps from each state to required_node
+} MarkovConstraints;
+
+/**
+ * Decoding parameters for generate_decoded_tweet.
+ */
+typedef struct DecodingParams {
+    int top_k; // sample among the k most frequent successors, 0 for all
+    double temperature; // frequencies are raised to 1/temperature before
+    // sampling, 1 for plain sampling, 0 or less for greedy decoding
+} DecodingParams;
+
+/**
+ * A sequence found by beam_search.
+ */
+typedef struct BeamSequence {
+    MarkovNode **states;
+    int length;
+    double log_prob; // log probability of the sequence given its first state
+} BeamSequence;
+
+/**
+ * A state or a transition reported by diff_chains, with its probability in
+ * each of the compared chains.
+ */
+typedef struct ChainDiff {
+    void *from; // the state
+    void *to; // the successor for a transition, NULL for a state
+    double prob_a;
+    double prob_b;
+} ChainDiff;
+
 /**
  * Get one random state from the given markov_chain's database.
  * @param markov_chain
- * @return
+ * @return a random state that is not last, NULL if there is none
  */
 MarkovNode* get_first_random_node(MarkovChain *markov_chain);
 
 /**
  * Choose randomly the next state, depend on it's occurrence frequency.
  * @param state_struct_ptr MarkovNode to choose from
- * @return MarkovNode of the chosen state
+ * @return MarkovNode of the chosen state, NULL if it has no successors
  */
 MarkovNode* get_next_random_node(MarkovNode *state_struct_ptr);
 
 /**
  * Receive markov_chain, generate and print random sentence out of it. The
- * sentence most have at least 2 words in it.
+ * sentence most have at least 2 words in it, unless it reaches a state
+ * without successors.
  * @param markov_chain
  * @param first_node markov_node to start with, if NULL- choose a random
  * markov_node
@@ -71,15 +140,229 @@ MarkovNode* get_next_random_node(MarkovNode *state_struct_ptr);
 void generate_tweet(MarkovChain *markov_chain, MarkovNode *
 first_node, int max_length);
 
+/**
+ * Choose the next state according to the given decoding parameters.
+ * Relies on frequencies_list being sorted by descending frequency.
+ * @param state_struct_ptr MarkovNode to choose from
+ * @param params decoding parameters
+ * @return MarkovNode of the chosen state, NULL if it has no successors
+ */
+MarkovNode* get_next_decoded_node(MarkovNode *state_struct_ptr,
+                                  const DecodingParams *params);
+
+/**
+ * Like generate_tweet, but choose every next state with
+ * get_next_decoded_node.
+ * @param markov_chain
+ * @param first_node markov_node to start with, if NULL- choose a random
+ * markov_node
+ * @param max_length maximum length of chain to generate
+ * @param params decoding parameters
+ */
+void generate_decoded_tweet(MarkovChain *markov_chain, MarkovNode *first_node,
+                            int max_length, const DecodingParams *params);
+
+/**
+ * Search for probable sequences of at most max_length states that start
+ * with first_node, keeping the beam_width most probable prefixes at every
+ * step. A sequence ends on a last state, on a state without successors, or
+ * when it reaches max_length states. The search is approximate: it can
+ * prune a prefix whose completion would be among the beam_width most
+ * probable sequences. It is exact only when beam_width is at least the
+ * number of sequences.
+ * @param markov_chain
+ * @param first_node markov_node to start with, if NULL- choose a random
+ * markov_node
+ * @param max_length maximum length of a sequence, at least 1
+ * @param beam_width number of sequences to keep at every step, at least 1
+ * @param num_sequences set to the number of returned sequences
+ * @return dynamically allocated array of sequences, sorted from the most
+ * probable, or NULL (with num_sequences set to 0) if max_length or
+ * beam_width is below 1, if the chain has no state to start with or in case
+ * of allocation error. Free with free_beam_sequences.
+ */
+BeamSequence *beam_search(MarkovChain *markov_chain, MarkovNode *first_node,
+                          int max_length, int beam_width,
+                          int *num_sequences);
+
+/**
+ * Free sequences returned by beam_search.
+ * @param sequences
+ * @param num_sequences
+ */
+void free_beam_sequences(BeamSequence *sequences, int num_sequences);
+
+/**
+ * Precompute the distance tables of the given constraints: for every state,
+ * the minimal number of steps to a last state and to the required state
+ * (-1 if unreachable). Must be called again if the chain changes, which
+ * frees the tables of the earlier call.
+ * @param markov_chain
+ * @param constraints constraints to prepare
+ * @return true on success, false if the required state is not in the
+ * chain or in case of allocation error.
+ */
+bool prepare_constraints(MarkovChain *markov_chain,
+                         MarkovConstraints *constraints);
+
+/**
+ * Free the tables allocated by prepare_constraints.
+ * @param constraints
+ */
+void free_constraints(MarkovConstraints *constraints);
+
+/**
+ * Generate and print a random sentence that satisfies the given prepared
+ * constraints. Only successors that can still satisfy the constraints are
+ * sampled (in proportion to their frequency), so a satisfying sentence is
+ * produced in a single pass.
+ * @param markov_chain
+ * @param constraints constraints prepared by prepare_constraints
+ * @param max_length maximum length of chain to generate
+ * @return the number of states printed, 0 if no sentence of at most
+ * max_length states satisfies the constraints or in case of allocation
+ * error (nothing is printed).
+ */
+int generate_constrained_tweet(MarkovChain *markov_chain,
+                               MarkovConstraints *constraints,
+                               int max_length);
+
+/**
+ * Compute the log-likelihood of a sequence of states under the chain: the
+ * sum of the log probabilities of its transitions. With additive smoothing
+ * alpha, the probability of moving from a to b is
+ * (count(a, b) + alpha) / (count(a) + alpha * number of states), so unseen
+ * transitions and unknown states get a small nonzero probability.
+ * @param markov_chain
+ * @param sequence states of the sequence, need not be in the chain
+ * @param length number of states in sequence
+ * @param smoothing additive smoothing alpha, 0 for none
+ * @return the log-likelihood, -INFINITY if the sequence has an unseen
+ * transition and smoothing is 0, or has a transition and the chain is empty
+ */
+double score_sequence(MarkovChain *markov_chain, void **sequence, int length,
+                      double smoothing);
+
+/**
+ * Compute the perplexity of a sequence of states under the chain, that is
+ * exp of minus its log-likelihood per transition.
+ * @param markov_chain
+ * @param sequence states of the sequence, need not be in the chain
+ * @param length number of states in sequence
+ * @param smoothing additive smoothing alpha, 0 for none
+ * @return the perplexity, 1 for sequences without transitions
+ */
+double get_perplexity(MarkovChain *markov_chain, void **sequence, int length,
+                      double smoothing);
+
+/**
+ * Compute score_sequence for many sequences, split between num_threads
+ * threads. The chain must not change while scoring.
+ * @param markov_chain
+ * @param sequences array of count sequences
+ * @param lengths number of states in each sequence
+ * @param count number of sequences
+ * @param smoothing additive smoothing alpha, 0 for none
+ * @param num_threads number of threads to use
+ * @param log_likelihoods output array of count log-likelihoods
+ */
+void score_sequences(MarkovChain *markov_chain, void ***sequences,
+                     const int *lengths, int count, double smoothing,
+                     int num_threads, double *log_likelihoods);
+
+/**
+ * Merge chains of the same type of states into a new chain, whose
+ * frequency of every transition is the weighted sum of its frequencies in
+ * the given chains, decayed to the current epoch of their chain. Unless
+ * MARKOV_FRACTIONAL_FREQUENCIES is defined the sums are rounded to the
+ * nearest integer (counts of chains of weight 1 are summed exactly), and
+ * transitions rounded to 0 are dropped. Works by sorting the states of
+ * every chain with comp_func and merging the sorted lists, without any
+ * lookups.
+ * @param chains the chains to merge, all with the same functions
+ * @param weights non-negative weight of every chain, NULL for weight 1 to
+ * all
+ * @param num_chains number of chains, at least 1
+ * @return new chain with the first chain's functions, NULL in case of
+ * allocation error
+ */
+MarkovChain *merge_chains(MarkovChain **chains, const double *weights,
+                          int num_chains);
+
+/**
+ * Compute time-decay weights for merge_chains: the last chain is the most
+ * recent and gets weight 1, every chain before it gets decay times the
+ * weight of the chain after it.
+ * @param decay decay factor between consecutive chains, in (0,1]
+ * @param num_chains number of chains
+ * @param weights output array of num_chains weights
+ */
+void get_decay_weights(double decay, int num_chains, double *weights);
+
+/**
+ * Find the states and the transitions whose probabilities changed most
+ * between two chains of the same type of states. The probability of a
+ * state is the share of the chain's transitions that leave it, and the
+ * probability of a transition is the probability to move from its state to
+ * its successor. Reported data belongs to chain_a if the state is in it,
+ * otherwise to chain_b.
+ * @param chain_a
+ * @param chain_b
+ * @param max_entries maximal number of states and of transitions to report
+ * @param states output array of max_entries states, by descending change
+ * @param num_states set to the number of reported states
+ * @param transitions output array of max_entries transitions, by
+ * descending change
+ * @param num_transitions set to the number of reported transitions
+ * @return true on success, false in case of allocation error
+ */
+bool diff_chains(MarkovChain *chain_a, MarkovChain *chain_b, int max_entries,
+                 ChainDiff *states, int *num_states, ChainDiff *transitions,
+                 int *num_transitions);
+
+/**
+ * Check whether two chains of the same type of states have exactly the
+ * same states and the same frequency for every transition, regardless of
+ * the order in which they were added.
+ * @param chain_a
+ * @param chain_b
+ * @return true if the chains are equal, false if not or in case of
+ * allocation error
+ */
+bool chains_equal(MarkovChain *chain_a, MarkovChain *chain_b);
+
+/**
+ * Check the invariants of a chain: the indices of its states are distinct
+ * and below its size, every state is found by get_node_from_database, and
+ * every frequencies list holds distinct states of the chain, is sorted by
+ * descending frequency and sums to frequencies_sum (up to rounding with
+ * fractional frequencies).
+ * @param markov_chain
+ * @return true if the chain is consistent, false if not or in case of
+ * allocation error
+ */
+bool is_chain_consistent(MarkovChain *markov_chain);
+
 /**
  * Free markov_chain and all of it's content from memory
  * @param markov_chain markov_chain to free
  */
 void free_database(MarkovChain **markov_chain);
 
+/**
+ * Start a new epoch: with MARKOV_FRACTIONAL_FREQUENCIES, every frequency
+ * added before is worth decay times less than one added from now on. The
+ * decay is applied lazily, to the frequencies of a node only when it gains
+ * a new transition; sampling doesn't need it, since all the frequencies of
+ * a node are decayed together.
+ * @param markov_chain
+ */
+void advance_epoch(MarkovChain *markov_chain);
+
 /**
  * Add the second markov_node to the counter list of the first markov_node.
- * If already in list, update it's counter value.
+ * If already in list, update it's counter value. The list is kept sorted
+ * by descending frequency.
  * @param first_node
  * @param second_node
  * @param markov_chain
@@ -91,7 +374,8 @@ bool add_node_to_frequencies_list(MarkovNode *first_node, MarkovNode
 
 /**
 * Check if data_ptr is in database. If so, return the markov_node wrapping it
- * in the markov_chain, otherwise return NULL.
+ * in the markov_chain, otherwise return NULL. Uses the hash index when the
+ * chain has a hash function.
  * @param markov_chain the chain to look in its database
  * @param data_ptr the state to look for
  * @return Pointer to the Node wrapping given state, NULL if state not in
@@ -115,4 +399,21 @@ Node* add_to_database(MarkovChain *markov_chain, void *data_ptr);
  */
 int get_random_number(int max_number);
 
+/**
+ * get unbiased random frequency between 0 and max_number [0,max_number)
+ * @param max_number maximal frequency to return (not including), positive
+ * @return random frequency
+ */
+frequency_t get_random_frequency(frequency_t max_number);
+
+/**
+ * Like get_random_frequency, but draws from rand_r with the given seed
+ * instead of rand, so that threads can draw random numbers independently.
+ * @param max_number maximal frequency to return (not including), positive
+ * @param seed the state of rand_r, NULL to use rand
+ * @return random frequency
+ */
+frequency_t get_random_frequency_r(frequency_t max_number,
+                                   unsigned int *seed);
+
 #endif /* MARKOV_CHAIN_H */
\ No newline at end of file
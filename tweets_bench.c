@@ -0,0 +1,2137 @@
+#define _GNU_SOURCE // For pthread_setaffinity_np(), sched_getaffinity()
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include "markov_chain.h"
+#include "words.h"
+#include "frozen_chain.h"
+#include "board.h"
+
+#define BASE 10
+#define SCORE_ARGS 5
+#define SCORE_ARGS_SMOOTHING 6
+#define CHECK_ARGS 4
+#define WALK_ARGS 5
+#define WALK_ARGS_THREADS 6
+#define WALK_SEED 1
+#define WALK_HASH_BASIS 14695981039346656037ULL // FNV-1a
+#define WALK_HASH_PRIME 1099511628211ULL
+#define DEFAULT_SMOOTHING 0.01
+#define DELIMITERS " \n\r\t"
+#define MIN_CHI_SQUARE_TOTAL 20 // states with fewer transitions are skipped
+#define CHI_SQUARE_Z 3.09 // standard normal quantile of 0.999
+#define MAX_CHI_SQUARE_FAILURES 0.01 // share of states allowed to fail
+#define CONSTRAINT_TRIALS 50
+#define SCORING_THREADS 4
+#define BEAM_CHECK_LENGTH 6
+#define BEAM_CHECK_SEQUENCES 128 // more than the check chain has
+#define DECODING_SAMPLES 10000
+#define DECODING_TOP_K 3
+#define MERGE_CHECK_DECAY 0.5
+#define DIFF_CHECK_ENTRIES 4
+#define SCORING_TOLERANCE 1e-12
+#define DECAY_CHECK_FACTOR 0.1
+#define DECAY_VANISH_FACTOR 0.5
+#define DECAY_VANISH_EPOCHS 2000 // enough for 0.5 to the power to be 0
+#define MAX_CONSTRAINED_LENGTH 20
+#define RANDOM_ARGS 4
+#define RANDOM_VOCABULARY 200
+#define RANDOM_WORD_LENGTH 8
+#define RANDOM_LAST_WORDS 10 // one word in this many ends a sentence
+#define RANDOM_LINE_WORDS 20
+#define RANDOM_CORPUS_BYTES (64 * 1024)
+#define RANDOM_HUGE_LINE_BYTES (256 * 1024)
+#define RANDOM_SAMPLES 2000
+#define RANDOM_WALKS 100
+#define RANDOM_WALK_LENGTH 50
+#define MAX_RANDOM_BOARD 300
+#define MAX_RANDOM_FACES 8
+#define MAX_RANDOM_WEIGHT 3
+
+/**
+ * sequences of words read from a file, one per line
+ */
+typedef struct Lines {
+    char **text; // the lines, words are pointers into them
+    void ***words;
+    int *lengths;
+    int count;
+    int capacity;
+} Lines;
+
+/**
+ * kinds of corpora generated by the random mode
+ */
+typedef enum CorpusKind {
+    CORPUS_WORDS, // lines of words from a small vocabulary
+    CORPUS_HUGE_LINE, // a single line of many words
+    CORPUS_NO_WHITESPACE, // a single huge word
+    CORPUS_BINARY, // random bytes
+    NUM_CORPUS_KINDS
+} CorpusKind;
+
+/**
+ * a chain to walk on by the indices of its states, in one of the
+ * representations below, the others NULL
+ */
+typedef struct Walker {
+    MarkovChain *markov_chain;
+    MarkovNode **nodes; // states of markov_chain by index
+    FrozenChain *frozen;
+    DenseBoard *dense;
+} Walker;
+
+/**
+ * the replica of a frozen chain on a NUMA node, made by the first thread
+ * of the node to need it and shared by the node's other threads
+ */
+typedef struct NodeReplica {
+    pthread_mutex_t lock;
+    FrozenChain *frozen; // NULL until made
+    bool failed;
+} NodeReplica;
+
+/**
+ * walks on a frozen chain run by one thread of run_walk_threads
+ */
+typedef struct WalkTask {
+    const FrozenChain *frozen; // the chain to walk on, or to replicate
+    NodeReplica *replica; // replica of the thread's node, NULL to walk on
+    // frozen itself
+    int cpu; // CPU to pin the thread to, -1 to leave it unpinned
+    int *starts;
+    int first; // the task runs the walks first, first + step, ...
+    int step;
+    int num_walks;
+    int length;
+    long steps;
+    uint64_t hash;
+    double start; // when the walks started, after getting the replica
+    double end; // when the walks ended
+    bool pinned;
+    bool success;
+} WalkTask;
+
+/**
+ * the function allocates and initializes a new empty markov chain of words
+ * @return the new chain, NULL in case of allocation error
+ */
+static MarkovChain *create_chain(void) {
+    MarkovChain *markov_chain = malloc(sizeof(MarkovChain));
+    if (markov_chain == NULL) {
+        return NULL;
+    }
+    LinkedList *database = malloc(sizeof(LinkedList));
+    if (database == NULL) {
+        free(markov_chain);
+        return NULL;
+    }
+    initializing_word_chain(markov_chain, database);
+    return markov_chain;
+}
+
+/**
+ * the function fills the database of the given chain with the transitions
+ * between consecutive words of the lines first, first + step, ...
+ * @param markov_chain a pointer to a markov chain
+ * @param lines lines read by read_lines
+ * @param first index of the first line to use
+ * @param step distance between used lines
+ * @return 0 if the database is filled successfully, else 1
+ */
+static int fill_database(MarkovChain *markov_chain, Lines *lines, int first,
+                         int step) {
+    for (int i = first; i < lines->count; i += step) {
+        Node *first_node = NULL;
+        for (int j = 0; j < lines->lengths[i]; j++) {
+            Node *second_node = add_to_database(markov_chain,
+                                                lines->words[i][j]);
+            if (second_node == NULL) { //memory problem
+                return 1;
+            }
+            if (first_node != NULL &&
+                !add_node_to_frequencies_list(first_node->data,
+                                              second_node->data,
+                                              markov_chain)) {
+                return 1; //memory problem
+            }
+            first_node = second_node;
+        }
+    }
+    return 0;
+}
+
+/**
+ * the function frees all lines read by read_lines
+ * @param lines
+ */
+static void free_lines(Lines *lines) {
+    for (int i = 0; i < lines->count; i++) {
+        free(lines->text[i]);
+        free(lines->words[i]);
+    }
+    free(lines->text);
+    free(lines->words);
+    free(lines->lengths);
+}
+
+/**
+ * the function reads the given file and splits every line to words
+ * @param fp a file
+ * @param lines the lines read, should be zero initialized
+ * @return 0 if the file is read successfully, else 1
+ */
+static int read_lines(FILE *fp, Lines *lines) {
+    char *line = NULL;
+    size_t line_capacity = 0;
+    while (getline(&line, &line_capacity, fp) != -1) {
+        if (lines->count == lines->capacity) {
+            int capacity = lines->capacity ? lines->capacity * 2 : 1024;
+            char **text = realloc(lines->text, sizeof(char *) * capacity);
+            if (text != NULL) {
+                lines->text = text;
+            }
+            void ***words = realloc(lines->words, sizeof(void **) * capacity);
+            if (words != NULL) {
+                lines->words = words;
+            }
+            int *lengths = realloc(lines->lengths, sizeof(int) * capacity);
+            if (lengths != NULL) {
+                lines->lengths = lengths;
+            }
+            if (text == NULL || words == NULL || lengths == NULL) {
+                free(line);
+                return 1;
+            }
+            lines->capacity = capacity;
+        }
+        char *text = copy_char(line);
+        void **words = malloc(sizeof(void *) * (strlen(line) / 2 + 1));
+        if (text == NULL || words == NULL) {
+            free(text);
+            free(words);
+            free(line);
+            return 1;
+        }
+        int length = 0;
+        for (char *word = strtok(text, DELIMITERS); word != NULL;
+             word = strtok(NULL, DELIMITERS)) {
+            words[length++] = word;
+        }
+        lines->text[lines->count] = text;
+        lines->words[lines->count] = words;
+        lines->lengths[lines->count] = length;
+        lines->count++;
+    }
+    free(line);
+    return 0;
+}
+
+/**
+ * @return the current time in seconds
+ */
+static double get_time(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * the function reads all lines of the given file
+ * @param path the path of the file
+ * @param lines the lines read, should be zero initialized
+ * @return 0 if the file is read successfully, else 1
+ */
+static int load_lines(char *path, Lines *lines) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        printf("Error: problem with reading file %s\n", path);
+        return 1;
+    }
+    if (read_lines(fp, lines)) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        fclose(fp);
+        return 1;
+    }
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * the function trains a new chain on the lines first, first + step, ...
+ * @param lines lines read by read_lines
+ * @param first index of the first line to use
+ * @param step distance between used lines
+ * @param hash hash function of the chain, NULL for linear lookups
+ * @return the trained chain, NULL on failure
+ */
+static MarkovChain *train_chain(Lines *lines, int first, int step,
+                                hash_func hash) {
+    MarkovChain *markov_chain = create_chain();
+    if (markov_chain == NULL) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        return NULL;
+    }
+    markov_chain->hash = hash;
+    if (fill_database(markov_chain, lines, first, step)) {
+        free_database(&markov_chain);
+    }
+    return markov_chain;
+}
+
+/**
+ * the function measures the throughput of score_sequences
+ * @param argv 2) train file 3) file of lines to score 4) number of threads
+ * 5) optional smoothing
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int bench_score(int argc, char *argv[]) {
+    char *endptr;
+    int num_threads = strtol(argv[4], &endptr, BASE);
+    double smoothing = DEFAULT_SMOOTHING;
+    if (argc == SCORE_ARGS_SMOOTHING) {
+        smoothing = strtod(argv[5], &endptr);
+    }
+    Lines train = {NULL, NULL, NULL, 0, 0}, lines = {NULL, NULL, NULL, 0, 0};
+    MarkovChain *markov_chain = NULL;
+    double *scores = NULL;
+    if (load_lines(argv[2], &train) || load_lines(argv[3], &lines) ||
+        (markov_chain = train_chain(&train, 0, 1, hash_word)) == NULL ||
+        (scores = malloc(sizeof(double) * (lines.count + 1))) == NULL) {
+        free_lines(&train);
+        free_lines(&lines);
+        if (markov_chain != NULL) {
+            free_database(&markov_chain);
+        }
+        return EXIT_FAILURE;
+    }
+    double start = get_time();
+    score_sequences(markov_chain, lines.words, lines.lengths, lines.count,
+                    smoothing, num_threads, scores);
+    double seconds = get_time() - start;
+    double sum = 0;
+    for (int i = 0; i < lines.count; i++) {
+        sum += scores[i];
+    }
+    printf("Scored %d lines with %d threads in %.3f seconds "
+           "(%.0f lines per second), mean log-likelihood %.3f\n",
+           lines.count, num_threads, seconds,
+           seconds > 0 ? lines.count / seconds : 0,
+           lines.count > 0 ? sum / lines.count : 0);
+    free(scores);
+    free_lines(&train);
+    free_lines(&lines);
+    free_database(&markov_chain);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * the function samples the successors of a state and computes the
+ * chi-square statistic of the observed counts against the frequencies
+ * @param node the state to sample from
+ * @param samples number of samples
+ * @param observed zero initialized counts by state index, zeroed again
+ * @return the chi-square statistic, with frequencies_list_len - 1 degrees
+ * of freedom
+ */
+static double sample_chi_square(MarkovNode *node, int samples,
+                                int *observed) {
+    double total = (double) node->frequencies_sum;
+    for (int i = 0; i < samples; i++) {
+        observed[get_next_random_node(node)->index]++;
+    }
+    double chi_square = 0;
+    for (int j = 0; j < node->frequencies_list_len; j++) {
+        MarkovNodeFrequency *edge = &node->frequencies_list[j];
+        double expected = samples * (edge->frequency / total);
+        double diff = observed[edge->markov_node->index] - expected;
+        chi_square += diff * diff / expected;
+        observed[edge->markov_node->index] = 0;
+    }
+    return chi_square;
+}
+
+/**
+ * the function checks that the sampled transitions of every state with
+ * enough transitions follow its frequencies, with a chi-square test
+ * @param markov_chain
+ * @param samples number of samples per state
+ * @return true if few enough states fail the test, else false
+ */
+static bool check_sampling(MarkovChain *markov_chain, int samples) {
+    int *observed = calloc(markov_chain->database->size + 1, sizeof(int));
+    if (observed == NULL) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        return false;
+    }
+    int tested = 0, failed = 0;
+    for (Node *cur = markov_chain->database->first; cur; cur = cur->next) {
+        MarkovNode *node = cur->data;
+        if (node->frequencies_list_len < 2 ||
+            node->frequencies_sum < MIN_CHI_SQUARE_TOTAL) {
+            continue;
+        }
+        // Wilson-Hilferty approximation of the critical value
+        double df = node->frequencies_list_len - 1;
+        double critical = df * pow(1 - 2 / (9 * df) +
+                                   CHI_SQUARE_Z * sqrt(2 / (9 * df)), 3);
+        tested++;
+        if (sample_chi_square(node, samples, observed) > critical) {
+            failed++;
+        }
+    }
+    free(observed);
+    printf("Chi-square test of sampling: %d of %d states failed\n",
+           failed, tested);
+    return failed <= MAX_CHI_SQUARE_FAILURES * tested;
+}
+
+/**
+ * the states printed by record_state since the last reset
+ */
+static void *recorded[MAX_CONSTRAINED_LENGTH + 1];
+static int num_recorded = 0;
+
+/**
+ * the function records a printed state instead of printing it
+ * @param data the state
+ */
+static void record_state(void *data) {
+    if (num_recorded <= MAX_CONSTRAINED_LENGTH) {
+        recorded[num_recorded] = data;
+    }
+    num_recorded++;
+}
+
+/**
+ * the function finds the minimal length of a walk that starts with a prefix,
+ * contains the required state and ends with a last state, by a breadth-first
+ * search over (state, required state seen) pairs that doesn't use the
+ * tables of prepare_constraints
+ * @param markov_chain
+ * @param start the last state of the prefix
+ * @param prefix_len length of the prefix
+ * @param seen true if the required state is in the prefix
+ * @param required the required state
+ * @return the minimal length, -1 if there is no such walk or in case of
+ * allocation error
+ */
+static int get_min_constrained_length(MarkovChain *markov_chain,
+                                      MarkovNode *start, int prefix_len,
+                                      bool seen, MarkovNode *required) {
+    if (markov_chain->is_last(start->data)) {
+        return seen ? prefix_len : -1;
+    }
+    int size = markov_chain->database->size;
+    int *dist = malloc(sizeof(int) * 2 * size);
+    MarkovNode **queue = malloc(sizeof(MarkovNode *) * 2 * size);
+    bool *queue_seen = malloc(sizeof(bool) * 2 * size);
+    if (dist == NULL || queue == NULL || queue_seen == NULL) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        free(dist);
+        free(queue);
+        free(queue_seen);
+        return -1;
+    }
+    for (int i = 0; i < 2 * size; i++) {
+        dist[i] = -1;
+    }
+    int head = 0, tail = 0, result = -1;
+    dist[2 * start->index + seen] = prefix_len;
+    queue[tail] = start;
+    queue_seen[tail++] = seen;
+    while (head < tail && result == -1) {
+        MarkovNode *node = queue[head];
+        bool node_seen = queue_seen[head++];
+        int length = dist[2 * node->index + node_seen] + 1;
+        for (int j = 0; j < node->frequencies_list_len && result == -1;
+             j++) {
+            MarkovNode *next = node->frequencies_list[j].markov_node;
+            bool next_seen = node_seen || next == required;
+            if (dist[2 * next->index + next_seen] != -1) {
+                continue;
+            }
+            dist[2 * next->index + next_seen] = length;
+            if (!markov_chain->is_last(next->data)) { // walks stop on last
+                queue[tail] = next;
+                queue_seen[tail++] = next_seen;
+            } else if (next_seen) {
+                result = length;
+            }
+        }
+    }
+    free(dist);
+    free(queue);
+    free(queue_seen);
+    return result;
+}
+
+/**
+ * the function checks that the recorded output of generate_constrained_tweet
+ * is a walk of the chain that satisfies the constraints
+ * @param markov_chain
+ * @param constraints the constraints, with must_end set
+ * @param length the length returned by generate_constrained_tweet
+ * @param max_length the maximal length it was given
+ * @return true if the output satisfies the constraints, else false
+ */
+static bool check_constrained_output(MarkovChain *markov_chain,
+                                     MarkovConstraints *constraints,
+                                     int length, int max_length) {
+    if (length != num_recorded || length < constraints->prefix_len ||
+        length > max_length ||
+        !markov_chain->is_last(recorded[length - 1])) {
+        return false;
+    }
+    bool seen = false;
+    MarkovNode *previous = NULL;
+    for (int i = 0; i < length; i++) {
+        MarkovNode *node = get_node_from_database(markov_chain,
+                                                  recorded[i])->data;
+        if (i < constraints->prefix_len &&
+            markov_chain->comp_func(recorded[i],
+                                    constraints->prefix[i]) != 0) {
+            return false;
+        }
+        int j = 0;
+        while (previous != NULL && j < previous->frequencies_list_len &&
+               previous->frequencies_list[j].markov_node != node) {
+            j++;
+        }
+        if (previous != NULL && j == previous->frequencies_list_len) {
+            return false; // not a transition of the chain
+        }
+        seen = seen || node == constraints->required_node;
+        previous = node;
+    }
+    return seen;
+}
+
+/**
+ * the function checks generate_constrained_tweet against a search for the
+ * shortest satisfying walk: for random prefixes and required states it must
+ * produce a satisfying walk when given the shortest length, and nothing
+ * when given one state less
+ * @param markov_chain
+ * @return true if all trials pass, else false
+ */
+static bool check_constraints(MarkovChain *markov_chain) {
+    print print_func = markov_chain->print_func;
+    markov_chain->print_func = record_state;
+    int failed = 0, satisfiable = 0;
+    for (int t = 0; t < CONSTRAINT_TRIALS; t++) {
+        MarkovNode *first = get_first_random_node(markov_chain);
+        if (first == NULL) {
+            break;
+        }
+        MarkovNode *second = get_next_random_node(first), *required = NULL;
+        int target = get_random_number(markov_chain->database->size);
+        for (Node *cur = markov_chain->database->first; cur;
+             cur = cur->next) {
+            if (cur->data->index == target) {
+                required = cur->data;
+            }
+        }
+        void *prefix[2] = {first->data, second ? second->data : NULL};
+        MarkovConstraints constraints = {prefix, second ? 2 : 1,
+                                         required->data, true,
+                                         NULL, NULL, NULL};
+        // prepared twice, like after a change of the chain, which must
+        // not leak the first tables
+        if (!prepare_constraints(markov_chain, &constraints) ||
+            !prepare_constraints(markov_chain, &constraints)) {
+            failed++;
+            break;
+        }
+        MarkovNode *start = second ? second : first;
+        int min_length = get_min_constrained_length(
+                markov_chain, start, constraints.prefix_len,
+                first == required || second == required, required);
+        int max_lengths[2] = {min_length, min_length - 1};
+        if (min_length == -1 || min_length > MAX_CONSTRAINED_LENGTH) {
+            max_lengths[0] = MAX_CONSTRAINED_LENGTH;
+            max_lengths[1] = min_length == -1 ? MAX_CONSTRAINED_LENGTH :
+                             MAX_CONSTRAINED_LENGTH - 1;
+        } else {
+            satisfiable++;
+        }
+        for (int k = 0; k < 2; k++) {
+            num_recorded = 0;
+            int length = generate_constrained_tweet(
+                    markov_chain, &constraints, max_lengths[k]);
+            bool expected = k == 0 && min_length != -1 &&
+                            min_length <= MAX_CONSTRAINED_LENGTH;
+            if (expected ? !check_constrained_output(markov_chain,
+                                                     &constraints, length,
+                                                     max_lengths[k]) :
+                length != 0) {
+                failed++;
+            }
+        }
+        free_constraints(&constraints);
+    }
+    markov_chain->print_func = print_func;
+    printf("Constrained generation: %s (%d of %d trials satisfiable)\n",
+           failed == 0 ? "OK" : "MISMATCH", satisfiable, CONSTRAINT_TRIALS);
+    return failed == 0;
+}
+
+/**
+ * the function checks that the frequencies list of every state is sorted
+ * by descending frequency, which greedy, top-k and beam search rely on
+ * @param markov_chain
+ * @return true if all lists are sorted, else false
+ */
+static bool check_order(MarkovChain *markov_chain) {
+    for (Node *cur = markov_chain->database->first; cur; cur = cur->next) {
+        MarkovNodeFrequency *list = cur->data->frequencies_list;
+        for (int j = 1; j < cur->data->frequencies_list_len; j++) {
+            if (list[j - 1].frequency < list[j].frequency) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * the function checks that a transition added after a decay is moved ahead
+ * of the decayed ones: with decay 0.1, "a b." twice and then "a c." in the
+ * next epoch, greedy decoding from "a" must choose the most frequent
+ * successor ("c." with fractional frequencies, "b." without)
+ * @return true if the check passes, else false
+ */
+static bool check_decayed_order(void) {
+    MarkovChain *markov_chain = create_chain();
+    if (markov_chain == NULL) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        return false;
+    }
+    markov_chain->decay = DECAY_CHECK_FACTOR;
+    void *seen[] = {"a", "b."}, *recent[] = {"a", "c."};
+    void **old_words[] = {seen, seen}, **new_words[] = {recent};
+    int lengths[] = {2, 2};
+    Lines old_lines = {NULL, old_words, lengths, 2, 2};
+    Lines new_lines = {NULL, new_words, lengths, 1, 1};
+    bool success = fill_database(markov_chain, &old_lines, 0, 1) == 0;
+    advance_epoch(markov_chain);
+    success = success && fill_database(markov_chain, &new_lines, 0, 1) == 0;
+    if (success) {
+        MarkovNode *node = get_node_from_database(markov_chain, "a")->data;
+        DecodingParams greedy = {0, 0};
+        MarkovNode *chosen = get_next_decoded_node(node, &greedy);
+        for (int j = 0; j < node->frequencies_list_len; j++) {
+            success = success && node->frequencies_list[j].frequency <=
+                                 node->frequencies_list[0].frequency &&
+                      (node->frequencies_list[j].markov_node != chosen ||
+                       node->frequencies_list[j].frequency ==
+                       node->frequencies_list[0].frequency);
+        }
+        success = success && check_order(markov_chain);
+    }
+    free_database(&markov_chain);
+    printf("Frequencies order after decay: %s\n",
+           success ? "OK" : "MISMATCH");
+    return success;
+}
+
+/**
+ * the function checks that transitions whose frequencies decay to 0 are
+ * dropped: with decay 0.5, "a b." and then "a c." DECAY_VANISH_EPOCHS epochs
+ * later, "a" must have "c." as its only successor with fractional
+ * frequencies, and both successors without. So a sentence that starts with
+ * "a" and contains "b." can't be generated with fractional frequencies,
+ * and must be "a b." without.
+ * @return true if the check passes, else false
+ */
+static bool check_vanished_transitions(void) {
+    MarkovChain *markov_chain = create_chain();
+    if (markov_chain == NULL) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        return false;
+    }
+    markov_chain->decay = DECAY_VANISH_FACTOR;
+    void *old_words[] = {"a", "b."}, *new_words[] = {"a", "c."};
+    void **old_lines_words[] = {old_words}, **new_lines_words[] = {new_words};
+    int lengths[] = {2};
+    Lines old_lines = {NULL, old_lines_words, lengths, 1, 1};
+    Lines new_lines = {NULL, new_lines_words, lengths, 1, 1};
+    bool success = fill_database(markov_chain, &old_lines, 0, 1) == 0;
+    for (int i = 0; i < DECAY_VANISH_EPOCHS; i++) {
+        advance_epoch(markov_chain);
+    }
+    success = success && fill_database(markov_chain, &new_lines, 0, 1) == 0;
+    if (success) {
+        MarkovNode *node = get_node_from_database(markov_chain, "a")->data;
+#ifdef MARKOV_FRACTIONAL_FREQUENCIES
+        success = node->frequencies_list_len == 1 &&
+                  comp_chars(node->frequencies_list[0].markov_node->data,
+                             "c.") == 0;
+#else
+        success = node->frequencies_list_len == 2;
+#endif
+        success = success && is_chain_consistent(markov_chain);
+    }
+    void *prefix[] = {"a"};
+    MarkovConstraints constraints = {prefix, 1, "b.", true, NULL, NULL, NULL};
+    if (success && prepare_constraints(markov_chain, &constraints)) {
+        print print_func = markov_chain->print_func;
+        markov_chain->print_func = record_state;
+        num_recorded = 0;
+        int length = generate_constrained_tweet(markov_chain, &constraints,
+                                                MAX_CONSTRAINED_LENGTH);
+        markov_chain->print_func = print_func;
+#ifdef MARKOV_FRACTIONAL_FREQUENCIES
+        success = length == 0 && num_recorded == 0;
+#else
+        success = check_constrained_output(markov_chain, &constraints,
+                                           length, MAX_CONSTRAINED_LENGTH);
+#endif
+        free_constraints(&constraints);
+    } else {
+        success = false;
+    }
+    free_database(&markov_chain);
+    printf("Transitions decayed to 0: %s\n", success ? "OK" : "MISMATCH");
+    return success;
+}
+
+/**
+ * the function trains a new chain on sentences of two words
+ * @param pairs the sentences
+ * @param count number of sentences
+ * @return the trained chain, NULL in case of allocation error
+ */
+static MarkovChain *train_pairs(void **pairs[], int count) {
+    MarkovChain *markov_chain = create_chain();
+    int *lengths = malloc(sizeof(int) * count);
+    if (markov_chain == NULL || lengths == NULL) {
+        if (markov_chain != NULL) {
+            free_database(&markov_chain);
+        }
+        free(lengths);
+        return NULL;
+    }
+    for (int i = 0; i < count; i++) {
+        lengths[i] = 2;
+    }
+    Lines lines = {NULL, pairs, lengths, count, count};
+    if (fill_database(markov_chain, &lines, 0, 1)) {
+        free_database(&markov_chain);
+    }
+    free(lengths);
+    return markov_chain;
+}
+
+/**
+ * the function finds the frequency of a transition
+ * @param markov_chain
+ * @param from the state
+ * @param to the successor
+ * @return the frequency, 0 if the chain has no such transition
+ */
+static double get_transition_frequency(MarkovChain *markov_chain, char *from,
+                                       char *to) {
+    Node *node = get_node_from_database(markov_chain, from);
+    for (int j = 0; node != NULL && j < node->data->frequencies_list_len;
+         j++) {
+        MarkovNodeFrequency *edge = &node->data->frequencies_list[j];
+        if (comp_chars(edge->markov_node->data, to) == 0) {
+            return (double) edge->frequency;
+        }
+    }
+    return 0;
+}
+
+/**
+ * the function checks a weighted merge against hand-computed frequencies:
+ * with decay 0.5 the weights of 3 chains are 0.25, 0.5 and 1, and "a" has
+ * the successors "b." once and "c." once in the first chain, "b." 3 times
+ * in the second, and "b." once and "d." 2 times in the last. So "d." gets
+ * 2, "b." gets 1 + (0.25 + 0.5 * 3) = 2.75, rounded to 3, and "c." gets
+ * 0.25, rounded to 0 and dropped, unless frequencies are fractional.
+ * @return true if the check passes, else false
+ */
+static bool check_weighted_merge(void) {
+    void *ab[] = {"a", "b."}, *ac[] = {"a", "c."}, *ad[] = {"a", "d."};
+    void **oldest[] = {ab, ac}, **old[] = {ab, ab, ab};
+    void **recent[] = {ab, ad, ad};
+    MarkovChain *chains[3] = {train_pairs(oldest, 2), train_pairs(old, 3),
+                              train_pairs(recent, 3)};
+    MarkovChain *merged = NULL;
+    double weights[3];
+    get_decay_weights(MERGE_CHECK_DECAY, 3, weights);
+    bool success = chains[0] && chains[1] && chains[2] &&
+                   (merged = merge_chains(chains, weights, 3)) != NULL;
+    if (!success) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+    } else {
+        Node *node = get_node_from_database(merged, "a");
+#ifdef MARKOV_FRACTIONAL_FREQUENCIES
+        int successors = 3;
+        double rounded = 2.75, dropped = 0.25;
+#else
+        int successors = 2;
+        double rounded = 3, dropped = 0;
+#endif
+        success = weights[0] == 0.25 && weights[1] == 0.5 &&
+                  weights[2] == 1 && merged->database->size == 4 &&
+                  node != NULL &&
+                  node->data->frequencies_list_len == successors &&
+                  get_transition_frequency(merged, "a", "b.") == rounded &&
+                  get_transition_frequency(merged, "a", "d.") == 2 &&
+                  get_transition_frequency(merged, "a", "c.") == dropped &&
+                  is_chain_consistent(merged);
+        printf("Weighted merge: %s\n", success ? "OK" : "MISMATCH");
+    }
+    for (int i = 0; i < 3; i++) {
+        if (chains[i] != NULL) {
+            free_database(&chains[i]);
+        }
+    }
+    if (merged != NULL) {
+        free_database(&merged);
+    }
+    return success;
+}
+
+/**
+ * the function checks reported entries of diff_chains against expected ones
+ * @param entries the reported entries
+ * @param num_entries number of reported entries
+ * @param expected the expected entries, in order
+ * @param num_expected number of expected entries
+ * @return true if they match, else false
+ */
+static bool diffs_match(ChainDiff *entries, int num_entries,
+                        ChainDiff *expected, int num_expected) {
+    if (num_entries != num_expected) {
+        return false;
+    }
+    for (int i = 0; i < num_entries; i++) {
+        if (comp_chars(entries[i].from, expected[i].from) != 0 ||
+            (entries[i].to == NULL) != (expected[i].to == NULL) ||
+            (entries[i].to != NULL &&
+             comp_chars(entries[i].to, expected[i].to) != 0) ||
+            fabs(entries[i].prob_a - expected[i].prob_a) >
+            SCORING_TOLERANCE ||
+            fabs(entries[i].prob_b - expected[i].prob_b) >
+            SCORING_TOLERANCE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * the function checks diff_chains on two small chains: "a" goes to "b." 3
+ * times and to "c." once in the first, and to "b." once, "c." once and
+ * "d." 3 times in the second; "x" goes to "y." only in the first, and "z"
+ * to "y." 3 times and to "w." once only in the second. The entries must
+ * come by descending change, cut at the given maximum, and states of one
+ * chain only must get probability 0 in the other.
+ * @return true if the check passes, else false
+ */
+static bool check_diff(void) {
+    void *ab[] = {"a", "b."}, *ac[] = {"a", "c."}, *ad[] = {"a", "d."};
+    void *xy[] = {"x", "y."}, *zy[] = {"z", "y."}, *zw[] = {"z", "w."};
+    void **first[] = {ab, ab, ab, ac, xy};
+    void **second[] = {ab, ac, ad, ad, ad, zy, zy, zy, zw};
+    MarkovChain *chain_a = train_pairs(first, 5);
+    MarkovChain *chain_b = train_pairs(second, 9);
+    ChainDiff states[DIFF_CHECK_ENTRIES], transitions[DIFF_CHECK_ENTRIES];
+    // states have 4 of 5 and 5 of 9 transitions in the first and second
+    ChainDiff expected_states[] = {{"z", NULL, 0, 4.0 / 9},
+                                   {"a", NULL, 4.0 / 5, 5.0 / 9},
+                                   {"x", NULL, 1.0 / 5, 0}};
+    ChainDiff expected_transitions[] = {{"x", "y.", 1, 0},
+                                        {"z", "y.", 0, 3.0 / 4},
+                                        {"a", "d.", 0, 3.0 / 5},
+                                        {"a", "b.", 3.0 / 4, 1.0 / 5}};
+    int num_states, num_transitions;
+    bool success = chain_a != NULL && chain_b != NULL;
+    if (!success) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+    } else {
+        // all changed states, and the 4 transitions that changed most of 6
+        success = diff_chains(chain_a, chain_b, DIFF_CHECK_ENTRIES, states,
+                              &num_states, transitions, &num_transitions) &&
+                  diffs_match(states, num_states, expected_states, 3) &&
+                  diffs_match(transitions, num_transitions,
+                              expected_transitions, 4) &&
+                  diff_chains(chain_a, chain_b, 2, states, &num_states,
+                              transitions, &num_transitions) &&
+                  diffs_match(states, num_states, expected_states, 2) &&
+                  diffs_match(transitions, num_transitions,
+                              expected_transitions, 2);
+        printf("Chain differences: %s\n", success ? "OK" : "MISMATCH");
+    }
+    if (chain_a != NULL) {
+        free_database(&chain_a);
+    }
+    if (chain_b != NULL) {
+        free_database(&chain_b);
+    }
+    return success;
+}
+
+/**
+ * a sequence found by enumerate_sequences
+ */
+typedef struct Enumerated {
+    MarkovNode *states[BEAM_CHECK_LENGTH];
+    int length;
+    double log_prob;
+} Enumerated;
+
+/**
+ * the function enumerates every sequence that beam_search could return:
+ * the extensions of a prefix until a last state, a state without
+ * successors, or max_length states
+ * @param markov_chain
+ * @param prefix the prefix, of at least 1 state
+ * @param max_length maximal length, at most BEAM_CHECK_LENGTH
+ * @param sequences the sequences found
+ * @param count number of sequences found, set to -1 if there are more
+ * than BEAM_CHECK_SEQUENCES
+ */
+static void enumerate_sequences(MarkovChain *markov_chain, Enumerated *prefix,
+                                int max_length, Enumerated *sequences,
+                                int *count) {
+    MarkovNode *last = prefix->states[prefix->length - 1];
+    if (*count == -1) {
+        return;
+    }
+    if (prefix->length == max_length || markov_chain->is_last(last->data) ||
+        last->frequencies_list_len == 0 || last->frequencies_sum <= 0) {
+        if (*count == BEAM_CHECK_SEQUENCES) {
+            *count = -1;
+        } else {
+            sequences[(*count)++] = *prefix;
+        }
+        return;
+    }
+    for (int j = 0; j < last->frequencies_list_len; j++) {
+        MarkovNodeFrequency *edge = &last->frequencies_list[j];
+        Enumerated extended = *prefix;
+        extended.states[extended.length++] = edge->markov_node;
+        extended.log_prob += log(edge->frequency /
+                                 (double) last->frequencies_sum);
+        enumerate_sequences(markov_chain, &extended, max_length, sequences,
+                            count);
+    }
+}
+
+/**
+ * the function checks beam_search against an exhaustive enumeration, with
+ * a beam as wide as the number of sequences, the narrowest that is exact:
+ * it must return every sequence once, with its probability, from the most
+ * probable
+ * @param markov_chain
+ * @param first_node the state to start with
+ * @return true if they match, else false
+ */
+static bool check_beam_exact(MarkovChain *markov_chain,
+                             MarkovNode *first_node) {
+    Enumerated sequences[BEAM_CHECK_SEQUENCES], prefix = {{first_node}, 1, 0};
+    bool matched[BEAM_CHECK_SEQUENCES] = {false};
+    int count = 0, num_beams;
+    enumerate_sequences(markov_chain, &prefix, BEAM_CHECK_LENGTH, sequences,
+                        &count);
+    BeamSequence *beams = beam_search(markov_chain, first_node,
+                                      BEAM_CHECK_LENGTH, count, &num_beams);
+    bool success = count > 1 && beams != NULL && num_beams == count;
+    for (int b = 0; success && b < num_beams; b++) {
+        int i = 0;
+        while (i < count && (matched[i] ||
+                             sequences[i].length != beams[b].length ||
+                             memcmp(sequences[i].states, beams[b].states,
+                                    sizeof(MarkovNode *) *
+                                    beams[b].length) != 0)) {
+            i++;
+        }
+        success = i < count && fabs(sequences[i].log_prob -
+                                    beams[b].log_prob) < SCORING_TOLERANCE &&
+                  (b == 0 || beams[b - 1].log_prob >= beams[b].log_prob);
+        if (success) {
+            matched[i] = true;
+        }
+    }
+    if (beams != NULL) {
+        free_beam_sequences(beams, num_beams);
+    }
+    return success;
+}
+
+/**
+ * the function checks get_next_decoded_node with top-k and a temperature
+ * by a chi-square test: the successor j of a state must be sampled with
+ * probability proportional to frequency_j ^ (1 / temperature) among the
+ * first top_k successors, and never after them
+ * @param node the state, with more than top_k successors
+ * @param params the decoding parameters
+ * @return true if the test passes, else false
+ */
+static bool check_top_k_temperature(MarkovNode *node,
+                                    const DecodingParams *params) {
+    int observed[DECODING_TOP_K] = {0}, outside = 0;
+    for (int i = 0; i < DECODING_SAMPLES; i++) {
+        MarkovNode *next = get_next_decoded_node(node, params);
+        int j = 0;
+        while (j < node->frequencies_list_len &&
+               node->frequencies_list[j].markov_node != next) {
+            j++;
+        }
+        if (j < params->top_k) {
+            observed[j]++;
+        } else {
+            outside++;
+        }
+    }
+    double weights[DECODING_TOP_K], sum = 0, chi_square = 0;
+    for (int j = 0; j < params->top_k; j++) {
+        weights[j] = pow((double) node->frequencies_list[j].frequency,
+                         1 / params->temperature);
+        sum += weights[j];
+    }
+    for (int j = 0; j < params->top_k; j++) {
+        double expected = DECODING_SAMPLES * weights[j] / sum;
+        double diff = observed[j] - expected;
+        chi_square += diff * diff / expected;
+    }
+    // Wilson-Hilferty approximation of the critical value
+    double df = params->top_k - 1;
+    double critical = df * pow(1 - 2 / (9 * df) +
+                               CHI_SQUARE_Z * sqrt(2 / (9 * df)), 3);
+    return outside == 0 && chi_square <= critical;
+}
+
+/**
+ * the function checks the decoding on a small chain: beam_search against
+ * an exhaustive enumeration of the sequences from "a", and top-k sampling
+ * with temperatures below and above 1 from "x", whose successors have the
+ * frequencies 8, 4, 2 and 1
+ * @return true if the checks pass, else false
+ */
+static bool check_decoding(void) {
+    MarkovChain *markov_chain = create_chain();
+    if (markov_chain == NULL) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        return false;
+    }
+    void *abac[] = {"a", "b", "a", "c."}, *abbd[] = {"a", "b", "b", "d."};
+    void *babc[] = {"b", "a", "b", "c."}, *aabd[] = {"a", "a", "b", "d."};
+    void *xb[] = {"x", "b."}, *xc[] = {"x", "c."}, *xd[] = {"x", "d."};
+    void *xe[] = {"x", "e."};
+    void **words[] = {abac, abbd, babc, aabd, abac,
+                      xb, xb, xb, xb, xb, xb, xb, xb, xc, xc, xc, xc, xd, xd,
+                      xe};
+    int lengths[] = {4, 4, 4, 4, 4,
+                     2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2};
+    Lines lines = {NULL, words, lengths, 20, 20};
+    bool success = fill_database(markov_chain, &lines, 0, 1) == 0;
+    if (success) {
+        MarkovNode *a = get_node_from_database(markov_chain, "a")->data;
+        MarkovNode *x = get_node_from_database(markov_chain, "x")->data;
+        bool beam = check_beam_exact(markov_chain, a);
+        DecodingParams sharp = {DECODING_TOP_K, 0.5};
+        DecodingParams flat = {DECODING_TOP_K, 2};
+        bool sampling = check_top_k_temperature(x, &sharp) &&
+                        check_top_k_temperature(x, &flat);
+        printf("Beam search against enumeration: %s\n",
+               beam ? "OK" : "MISMATCH");
+        printf("Top-k sampling with temperature: %s\n",
+               sampling ? "OK" : "MISMATCH");
+        success = beam && sampling;
+    } else {
+        printf(ALLOCATION_ERROR_MASSAGE);
+    }
+    free_database(&markov_chain);
+    return success;
+}
+
+/**
+ * the function checks score_sequence against a hand-computed value
+ * @param markov_chain
+ * @param words the sequence
+ * @param length number of words
+ * @param smoothing additive smoothing alpha
+ * @param expected the hand-computed log-likelihood
+ * @return true if they match, else false
+ */
+static bool check_score(MarkovChain *markov_chain, void **words, int length,
+                        double smoothing, double expected) {
+    double score = score_sequence(markov_chain, words, length, smoothing);
+    if (isinf(expected)) {
+        return score == expected;
+    }
+    return fabs(score - expected) < SCORING_TOLERANCE;
+}
+
+/**
+ * the function checks score_sequence against hand-computed values on a
+ * chain of "a b." twice and "a c." once, whose 3 states give "a" the
+ * successors "b." (2) and "c." (1): a seen transition, an unseen one with
+ * and without smoothing, unknown states and an empty chain. Then it checks
+ * that score_sequences with several threads gives the serial scores bit
+ * for bit.
+ * @param markov_chain a trained chain to score lines on
+ * @param lines the lines to score
+ * @return true if the checks pass, else false
+ */
+static bool check_scoring(MarkovChain *markov_chain, Lines *lines) {
+    MarkovChain *tiny = create_chain(), *empty = create_chain();
+    double *serial = malloc(sizeof(double) * (lines->count + 1));
+    double *threaded = malloc(sizeof(double) * (lines->count + 1));
+    bool success = tiny != NULL && empty != NULL && serial != NULL &&
+                   threaded != NULL;
+    void *b[] = {"a", "b."}, *c[] = {"a", "c."};
+    void **tiny_words[] = {b, b, c};
+    int lengths[] = {2, 2, 2};
+    Lines tiny_lines = {NULL, tiny_words, lengths, 3, 3};
+    success = success && fill_database(tiny, &tiny_lines, 0, 1) == 0;
+    if (!success) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+    } else {
+        void *unseen[] = {"a", "a", "b."}, *unknown_from[] = {"z", "b."};
+        void *unknown_to[] = {"a", "z"};
+        success = check_score(tiny, b, 2, 0, log(2.0 / 3)) &&
+                  check_score(tiny, b, 2, 1, log(3.0 / 6)) &&
+                  check_score(tiny, unseen, 3, 0, -INFINITY) &&
+                  check_score(tiny, unseen, 3, 1,
+                              log(1.0 / 6) + log(3.0 / 6)) &&
+                  check_score(tiny, unknown_from, 2, 0, -INFINITY) &&
+                  check_score(tiny, unknown_from, 2, 1, log(1.0 / 3)) &&
+                  check_score(tiny, unknown_to, 2, 1, log(1.0 / 6)) &&
+                  check_score(tiny, b, 1, 0, 0) &&
+                  check_score(empty, b, 2, 1, -INFINITY);
+        printf("Scores of a tiny chain: %s\n", success ? "OK" : "MISMATCH");
+    }
+    double smoothings[] = {0, DEFAULT_SMOOTHING};
+    bool same = success;
+    for (int k = 0; same && k < 2; k++) {
+        for (int i = 0; i < lines->count; i++) {
+            serial[i] = score_sequence(markov_chain, lines->words[i],
+                                       lines->lengths[i], smoothings[k]);
+        }
+        score_sequences(markov_chain, lines->words, lines->lengths,
+                        lines->count, smoothings[k], SCORING_THREADS,
+                        threaded);
+        same = memcmp(serial, threaded, sizeof(double) * lines->count) == 0;
+    }
+    if (success) {
+        printf("Threaded scores: %s\n", same ? "OK" : "MISMATCH");
+    }
+    if (tiny != NULL) {
+        free_database(&tiny);
+    }
+    if (empty != NULL) {
+        free_database(&empty);
+    }
+    free(serial);
+    free(threaded);
+    return success && same;
+}
+
+/**
+ * the function checks the optimized paths against the reference ones:
+ * hashed against linear lookups, merged against directly trained chains,
+ * sampled transitions against the frequencies, constrained generation
+ * against a search for the shortest satisfying walk, the order of the
+ * frequencies lists, the dropping of transitions that decayed to 0, the
+ * scores of sequences against hand-computed and serial ones, the
+ * decoding against enumerated sequences and expected distributions, and
+ * weighted merges and differences of chains against hand-computed ones
+ * @param argv 2) file to train on 3) number of samples per state
+ * @return EXIT_SUCCESS if all checks pass, else EXIT_FAILURE
+ */
+static int check(char *argv[]) {
+    char *endptr;
+    int samples = strtol(argv[3], &endptr, BASE);
+    Lines lines = {NULL, NULL, NULL, 0, 0};
+    if (load_lines(argv[2], &lines)) {
+        free_lines(&lines);
+        return EXIT_FAILURE;
+    }
+    MarkovChain *chains[4] = {train_chain(&lines, 0, 1, NULL),
+                              train_chain(&lines, 0, 1, hash_word),
+                              train_chain(&lines, 0, 2, hash_word),
+                              train_chain(&lines, 1, 2, hash_word)};
+    MarkovChain *merged = NULL;
+    bool success = chains[0] && chains[1] && chains[2] && chains[3] &&
+                   (merged = merge_chains(chains + 2, NULL, 2)) != NULL;
+    if (success) {
+        bool hashed = chains_equal(chains[0], chains[1]);
+        bool merge = chains_equal(chains[0], merged);
+        printf("Hashed lookups: %s\n", hashed ? "OK" : "MISMATCH");
+        printf("Merged halves: %s\n", merge ? "OK" : "MISMATCH");
+        bool order = check_order(chains[1]);
+        printf("Frequencies order: %s\n", order ? "OK" : "MISMATCH");
+        success = check_decayed_order() && check_vanished_transitions() &&
+                  check_constraints(chains[1]) &&
+                  check_scoring(chains[1], &lines) && check_decoding() &&
+                  check_weighted_merge() && check_diff() &&
+                  hashed && merge && order &&
+                  check_sampling(chains[1], samples);
+    }
+    for (int i = 0; i < 4; i++) {
+        if (chains[i] != NULL) {
+            free_database(&chains[i]);
+        }
+    }
+    if (merged != NULL) {
+        free_database(&merged);
+    }
+    free_lines(&lines);
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * the function lists the states of a chain by index
+ * @param markov_chain
+ * @return the states, NULL in case of allocation error
+ */
+static MarkovNode **get_nodes(MarkovChain *markov_chain) {
+    MarkovNode **nodes = malloc(sizeof(MarkovNode *) *
+                                (markov_chain->database->size + 1));
+    if (nodes == NULL) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        return NULL;
+    }
+    for (Node *cur = markov_chain->database->first; cur; cur = cur->next) {
+        nodes[cur->data->index] = cur->data;
+    }
+    return nodes;
+}
+
+/**
+ * the function adds a visited state to the hash of a walk
+ * @param hash the hash of the states visited before
+ * @param state index of the visited state
+ * @return the new hash
+ */
+static uint64_t hash_state(uint64_t hash, int state) {
+    return (hash ^ (uint64_t) (unsigned int) state) * WALK_HASH_PRIME;
+}
+
+/**
+ * the function runs random walks on the linked chain, like generate_tweet
+ * @param markov_chain
+ * @param nodes the chain's states by index
+ * @param starts index of the first state of every walk
+ * @param num_walks number of walks
+ * @param length maximal length of a walk
+ * @param hash set to the sum of the hashes of the visited states of every
+ * walk
+ * @return the number of steps made
+ */
+static long walk_linked(MarkovChain *markov_chain, MarkovNode **nodes,
+                        int *starts, int num_walks, int length,
+                        uint64_t *hash) {
+    long steps = 0;
+    *hash = 0;
+    for (int w = 0; w < num_walks; w++) {
+        MarkovNode *node = nodes[starts[w]];
+        uint64_t walk_hash = hash_state(WALK_HASH_BASIS, starts[w]);
+        for (int i = 1; i < length; i++) {
+            node = get_next_random_node(node);
+            if (node == NULL) {
+                break;
+            }
+            steps++;
+            walk_hash = hash_state(walk_hash, node->index);
+            if (markov_chain->is_last(node->data)) {
+                break;
+            }
+        }
+        *hash += walk_hash;
+    }
+    return steps;
+}
+
+/**
+ * the function runs random walks on the frozen chain
+ * @param frozen
+ * @param starts index of the first state of every walk
+ * @param first index of the first walk to run
+ * @param step distance between run walks
+ * @param num_walks number of walks
+ * @param length maximal length of a walk
+ * @param seeded true to draw walk w from rand_r with the seed
+ * WALK_SEED + w, so that walks don't depend on the thread that runs them,
+ * false to draw from rand
+ * @param hash set to the sum of the hashes of the visited states of every
+ * walk
+ * @return the number of steps made
+ */
+static long walk_frozen(const FrozenChain *frozen, int *starts, int first,
+                        int step, int num_walks, int length, bool seeded,
+                        uint64_t *hash) {
+    long steps = 0;
+    *hash = 0;
+    for (int w = first; w < num_walks; w += step) {
+        unsigned int seed = WALK_SEED + w;
+        int state = starts[w];
+        uint64_t walk_hash = hash_state(WALK_HASH_BASIS, state);
+        for (int i = 1; i < length; i++) {
+            state = get_next_frozen_state_r(frozen, state,
+                                            seeded ? &seed : NULL);
+            if (state == -1) {
+                break;
+            }
+            steps++;
+            walk_hash = hash_state(walk_hash, state);
+            if (frozen->states[state].is_last) {
+                break;
+            }
+        }
+        *hash += walk_hash;
+    }
+    return steps;
+}
+
+/**
+ * the function gets the replica of the node of a pinned thread, and makes
+ * it if the thread is the first of the node
+ * @param task the task of the thread
+ * @return the replica, NULL in case of allocation error
+ */
+static const FrozenChain *get_node_replica(WalkTask *task) {
+    NodeReplica *replica = task->replica;
+    pthread_mutex_lock(&replica->lock);
+    if (replica->frozen == NULL && !replica->failed) {
+        // written by this thread, so placed on the NUMA node of its CPU
+        replica->frozen = replicate_frozen_chain(task->frozen);
+        replica->failed = replica->frozen == NULL;
+    }
+    pthread_mutex_unlock(&replica->lock);
+    return replica->frozen;
+}
+
+/**
+ * the function runs the walks of a WalkTask: pins the thread, gets the
+ * replica of its node if needed and walks on it
+ * @param arg the WalkTask
+ * @return NULL
+ */
+static void *run_walk_task(void *arg) {
+    WalkTask *task = arg;
+    task->pinned = false;
+    if (task->cpu != -1) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(task->cpu, &cpus);
+        task->pinned = pthread_setaffinity_np(pthread_self(),
+                                              sizeof(cpu_set_t), &cpus) == 0;
+    }
+    const FrozenChain *frozen = task->replica != NULL ?
+                                get_node_replica(task) : task->frozen;
+    task->success = frozen != NULL;
+    if (task->success) {
+        task->start = get_time();
+        task->steps = walk_frozen(frozen, task->starts, task->first,
+                                  task->step, task->num_walks, task->length,
+                                  true, &task->hash);
+        task->end = get_time();
+    }
+    return NULL;
+}
+
+/**
+ * the function finds the CPU to pin a thread to: the CPUs the process may
+ * run on are used in turn
+ * @param thread number of the thread
+ * @return the CPU, -1 if it can't be found
+ */
+static int get_walk_cpu(int thread) {
+    cpu_set_t cpus;
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &cpus) != 0 ||
+        CPU_COUNT(&cpus) == 0) {
+        return -1;
+    }
+    int n = thread % CPU_COUNT(&cpus);
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &cpus) && n-- == 0) {
+            return cpu;
+        }
+    }
+    return -1;
+}
+
+/**
+ * the function makes the replica slots of the NUMA nodes of the CPUs the
+ * threads are pinned to
+ * @param tasks the tasks of the threads, with their CPUs
+ * @param num_threads number of threads
+ * @param num_nodes set to the number of slots, the highest node + 1
+ * @return the slots, NULL in case of allocation error
+ */
+static NodeReplica *create_node_replicas(WalkTask *tasks, int num_threads,
+                                         int *num_nodes) {
+    int *nodes = malloc(sizeof(int) * num_threads);
+    if (nodes == NULL) {
+        return NULL;
+    }
+    *num_nodes = 1;
+    for (int t = 0; t < num_threads; t++) {
+        nodes[t] = tasks[t].cpu != -1 ? get_numa_node(tasks[t].cpu) : 0;
+        if (nodes[t] >= *num_nodes) {
+            *num_nodes = nodes[t] + 1;
+        }
+    }
+    NodeReplica *replicas = malloc(sizeof(NodeReplica) * *num_nodes);
+    for (int n = 0; replicas != NULL && n < *num_nodes; n++) {
+        pthread_mutex_init(&replicas[n].lock, NULL);
+        replicas[n].frozen = NULL;
+        replicas[n].failed = false;
+    }
+    for (int t = 0; replicas != NULL && t < num_threads; t++) {
+        tasks[t].replica = &replicas[nodes[t]];
+    }
+    free(nodes);
+    return replicas;
+}
+
+/**
+ * the function frees the replicas of the NUMA nodes
+ * @param replicas the slots made by create_node_replicas
+ * @param num_nodes number of slots
+ * @return the number of replicas that were made
+ */
+static int free_node_replicas(NodeReplica *replicas, int num_nodes) {
+    int made = 0;
+    for (int n = 0; replicas != NULL && n < num_nodes; n++) {
+        if (replicas[n].frozen != NULL) {
+            free_frozen_chain(&replicas[n].frozen);
+            made++;
+        }
+        pthread_mutex_destroy(&replicas[n].lock);
+    }
+    free(replicas);
+    return made;
+}
+
+/**
+ * the function runs seeded walks on a frozen chain with pinned threads,
+ * every thread running every num_threads-th walk
+ * @param frozen the chain to walk on
+ * @param per_node true for the threads of every NUMA node to walk on a
+ * replica of the chain on their node, false for all threads to share it
+ * @param num_threads number of threads
+ * @param starts index of the first state of every walk
+ * @param num_walks number of walks
+ * @param length maximal length of a walk
+ * @param steps set to the number of steps made
+ * @param hash set to the sum of the hashes of the visited states of every
+ * walk
+ * @param seconds set to the time from the first thread starting its walks
+ * to the last one ending them
+ * @param num_replicas set to the number of replicas made
+ * @return true on success, else false
+ */
+static bool run_walk_threads(const FrozenChain *frozen, bool per_node,
+                             int num_threads, int *starts, int num_walks,
+                             int length, long *steps, uint64_t *hash,
+                             double *seconds, int *num_replicas) {
+    WalkTask *tasks = malloc(sizeof(WalkTask) * num_threads);
+    pthread_t *threads = malloc(sizeof(pthread_t) * num_threads);
+    bool *started = calloc(num_threads, sizeof(bool));
+    NodeReplica *replicas = NULL;
+    int num_nodes = 0;
+    bool success = tasks != NULL && threads != NULL && started != NULL;
+    for (int t = 0; success && t < num_threads; t++) {
+        tasks[t] = (WalkTask) {frozen, NULL, get_walk_cpu(t), starts, t,
+                               num_threads, num_walks, length, 0, 0, 0, 0,
+                               false, false};
+    }
+    if (success && per_node) {
+        replicas = create_node_replicas(tasks, num_threads, &num_nodes);
+        success = replicas != NULL;
+    }
+    if (!success) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+    }
+    for (int t = 0; success && t < num_threads; t++) {
+        started[t] = pthread_create(&threads[t], NULL, run_walk_task,
+                                    &tasks[t]) == 0;
+        if (!started[t]) {
+            printf("Error: failed to start a walking thread\n");
+            success = false;
+        }
+    }
+    int pinned = 0;
+    double start = 0, end = 0;
+    *steps = 0;
+    *hash = 0;
+    for (int t = 0; started != NULL && t < num_threads; t++) {
+        if (started[t]) {
+            pthread_join(threads[t], NULL);
+            success = success && tasks[t].success;
+            pinned += tasks[t].pinned;
+            *steps += tasks[t].steps;
+            *hash += tasks[t].hash;
+            if (t == 0 || tasks[t].start < start) {
+                start = tasks[t].start;
+            }
+            if (tasks[t].end > end) {
+                end = tasks[t].end;
+            }
+        }
+    }
+    *seconds = end - start;
+    *num_replicas = free_node_replicas(replicas, num_nodes);
+    if (success && pinned < num_threads) {
+        printf("Warning: %d of %d threads could not be pinned\n",
+               num_threads - pinned, num_threads);
+    }
+    free(tasks);
+    free(threads);
+    free(started);
+    return success;
+}
+
+/**
+ * the function prints the throughput of a walk benchmark
+ * @param name name of the benchmark
+ * @param steps number of steps made
+ * @param seconds time it took
+ */
+static void print_walk(char *name, long steps, double seconds) {
+    printf("%-44s %ld steps in %.3f seconds (%.0f steps per second)\n",
+           name, steps, seconds, seconds > 0 ? steps / seconds : 0);
+}
+
+/**
+ * the function names a placement
+ * @param placement
+ * @return the name
+ */
+static char *placement_name(Placement placement) {
+    switch (placement) {
+        case PLACEMENT_HUGEPAGES:
+            return "frozen, 2 MB hugepages:";
+        case PLACEMENT_TRANSPARENT_HUGEPAGES:
+            return "frozen, transparent hugepages:";
+        default:
+            return "frozen, regular pages:";
+    }
+}
+
+/**
+ * the function compares the walks of a benchmark with the reference walks
+ * @param steps, hash steps made and hash of the visited states
+ * @param reference_steps, reference_hash the same for the reference walks
+ * @return true if the walks visited the same states, else false
+ */
+static bool same_walks(long steps, uint64_t hash, long reference_steps,
+                       uint64_t reference_hash) {
+    if (steps != reference_steps || hash != reference_hash) {
+        printf("Error: walks visited other states than the reference\n");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * the function checks the mapping of a frozen chain: hugepage mappings
+ * must start on and be a multiple of HUGEPAGE_SIZE, regular ones must be
+ * the size needed rounded up to the page size
+ * @param frozen
+ * @return true if it is, else false
+ */
+static bool is_mapping_aligned(FrozenChain *frozen) {
+    if (frozen->placement != PLACEMENT_PAGES) {
+        return (uintptr_t) frozen->memory % HUGEPAGE_SIZE == 0 &&
+               frozen->size % HUGEPAGE_SIZE == 0;
+    }
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    size_t needed = (char *) (frozen->edges + frozen->num_edges) -
+                    (char *) frozen->memory;
+    return frozen->size % page_size == 0 && frozen->size >= needed &&
+           frozen->size <= needed + page_size;
+}
+
+/**
+ * the function compares random walks on the linked chain with walks on
+ * frozen copies of it, placed on regular pages and on hugepages, all drawn
+ * from rand. Then it runs walks seeded by walk on the hugepages copy: on
+ * the calling thread, and on pinned threads that share the copy or walk on
+ * one replica of it per NUMA node. All walks must visit the same states as
+ * the walks they are compared with.
+ * @param argc num of arguments
+ * @param argv 2) file to train on 3) number of walks 4) maximal length
+ * 5) optional number of threads, by default the number of CPUs the process
+ * may run on
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int bench_walk(int argc, char *argv[]) {
+    char *endptr;
+    int num_walks = strtol(argv[3], &endptr, BASE);
+    int length = strtol(argv[4], &endptr, BASE);
+    int num_threads = 1;
+    cpu_set_t cpus;
+    if (argc == WALK_ARGS_THREADS) {
+        num_threads = strtol(argv[5], &endptr, BASE);
+    } else if (sched_getaffinity(0, sizeof(cpu_set_t), &cpus) == 0 &&
+               CPU_COUNT(&cpus) > 0) {
+        num_threads = CPU_COUNT(&cpus);
+    }
+    if (num_walks < 0 || length < 1 || num_threads < 1) {
+        printf("Error: walks must be non-negative, length and threads "
+               "positive\n");
+        return EXIT_FAILURE;
+    }
+    Lines lines = {NULL, NULL, NULL, 0, 0};
+    MarkovChain *markov_chain = NULL;
+    if (load_lines(argv[2], &lines) ||
+        (markov_chain = train_chain(&lines, 0, 1, hash_word)) == NULL) {
+        free_lines(&lines);
+        return EXIT_FAILURE;
+    }
+    free_lines(&lines);
+    int size = markov_chain->database->size;
+    MarkovNode **nodes = get_nodes(markov_chain);
+    int *starts = malloc(sizeof(int) * (num_walks + 1));
+    FrozenChain *frozen[2] = {NULL, NULL};
+    bool success = nodes != NULL && starts != NULL &&
+                   (frozen[0] = freeze_chain(markov_chain, false)) != NULL &&
+                   (frozen[1] = freeze_chain(markov_chain, true)) != NULL;
+    if (success && get_first_random_node(markov_chain) == NULL) {
+        printf("Error: no state to start a walk from\n");
+        success = false;
+    } else if (success && (!is_mapping_aligned(frozen[0]) ||
+                           !is_mapping_aligned(frozen[1]))) {
+        printf("Error: frozen chain mapping is not aligned\n");
+        success = false;
+    } else if (success) {
+        srand(WALK_SEED);
+        for (int w = 0; w < num_walks; w++) {
+            // like get_first_random_node, without walking the list
+            do {
+                starts[w] = get_random_number(size);
+            } while (markov_chain->is_last(nodes[starts[w]]->data));
+        }
+        srand(WALK_SEED);
+        uint64_t reference_hash, hash;
+        double start = get_time();
+        long reference_steps = walk_linked(markov_chain, nodes, starts,
+                                           num_walks, length,
+                                           &reference_hash);
+        print_walk("linked graph:", reference_steps, get_time() - start);
+        for (int f = 0; f < 2; f++) {
+            srand(WALK_SEED);
+            start = get_time();
+            long steps = walk_frozen(frozen[f], starts, 0, 1, num_walks,
+                                     length, false, &hash);
+            print_walk(placement_name(frozen[f]->placement), steps,
+                       get_time() - start);
+            success = same_walks(steps, hash, reference_steps,
+                                 reference_hash) && success;
+        }
+        start = get_time();
+        reference_steps = walk_frozen(frozen[1], starts, 0, 1, num_walks,
+                                      length, true, &reference_hash);
+        print_walk("frozen, seeded walks, 1 thread:", reference_steps,
+                   get_time() - start);
+        for (int r = 0; success && r < 2; r++) {
+            long steps;
+            double seconds;
+            int num_replicas;
+            char name[96], replicas[32] = "shared";
+            success = run_walk_threads(frozen[1], r, num_threads, starts,
+                                       num_walks, length, &steps, &hash,
+                                       &seconds, &num_replicas);
+            if (r) {
+                snprintf(replicas, sizeof(replicas), "%d node replica%s",
+                         num_replicas, num_replicas == 1 ? "" : "s");
+            }
+            snprintf(name, sizeof(name), "frozen, %d pinned thread%s, %s:",
+                     num_threads, num_threads == 1 ? "" : "s", replicas);
+            if (success) {
+                print_walk(name, steps, seconds);
+                success = same_walks(steps, hash, reference_steps,
+                                     reference_hash);
+            }
+        }
+    }
+    for (int f = 0; f < 2; f++) {
+        if (frozen[f] != NULL) {
+            free_frozen_chain(&frozen[f]);
+        }
+    }
+    if (starts == NULL) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+    }
+    free(nodes);
+    free(starts);
+    free_database(&markov_chain);
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * the function generates a random corpus
+ * @param kind the kind of corpus
+ * @param size set to the size of the corpus
+ * @return the corpus, NULL in case of allocation error
+ */
+static char *generate_corpus(CorpusKind kind, size_t *size) {
+    char vocabulary[RANDOM_VOCABULARY][RANDOM_WORD_LENGTH + 2];
+    for (int k = 0; k < RANDOM_VOCABULARY; k++) {
+        int length = 1 + rand() % RANDOM_WORD_LENGTH;
+        for (int c = 0; c < length; c++) {
+            vocabulary[k][c] = (char) ('a' + rand() % 26);
+        }
+        if (rand() % RANDOM_LAST_WORDS == 0) {
+            vocabulary[k][length++] = '.';
+        }
+        vocabulary[k][length] = '\0';
+    }
+    size_t capacity = kind == CORPUS_HUGE_LINE ? RANDOM_HUGE_LINE_BYTES :
+                      RANDOM_CORPUS_BYTES;
+    char *corpus = malloc(capacity + RANDOM_WORD_LENGTH + 3);
+    if (corpus == NULL) {
+        return NULL;
+    }
+    *size = 0;
+    int line_words = 0;
+    while (*size < capacity) {
+        if (kind == CORPUS_BINARY) {
+            corpus[(*size)++] = (char) (rand() % 256);
+        } else if (kind == CORPUS_NO_WHITESPACE) {
+            corpus[(*size)++] = (char) ('!' + rand() % ('~' - '!' + 1));
+        } else {
+            // skewed choice, so some transitions are frequent
+            char *word = vocabulary[rand() % (1 + rand() %
+                                              RANDOM_VOCABULARY)];
+            for (char *c = word; *c != '\0'; c++) {
+                corpus[(*size)++] = *c;
+            }
+            line_words++;
+            if (kind == CORPUS_WORDS &&
+                line_words >= 1 + rand() % RANDOM_LINE_WORDS) {
+                corpus[(*size)++] = '\n';
+                line_words = 0;
+            } else {
+                corpus[(*size)++] = rand() % 2 ? ' ' : '\t';
+            }
+        }
+    }
+    return corpus;
+}
+
+/**
+ * the function generates a random board: a random number of cells and dice
+ * faces, random weights and random jumps to cells without jumps
+ * @param board the board to generate, zero initialized
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of allocation error
+ */
+static int generate_board(Board *board) {
+    int size = 2 + rand() % MAX_RANDOM_BOARD;
+    if (allocate_board(board, size, 1 + rand() % MAX_RANDOM_FACES) ==
+        EXIT_FAILURE) {
+        return EXIT_FAILURE;
+    }
+    int dice_sum = 0;
+    for (int j = 0; j < board->dice_max; j++) {
+        board->dice[j] = rand() % (MAX_RANDOM_WEIGHT + 1);
+        dice_sum += board->dice[j];
+    }
+    if (dice_sum == 0) {
+        board->dice[rand() % board->dice_max] = 1;
+    }
+    int num_jumps = rand() % (size / 4 + 1);
+    for (int k = 0; k < num_jumps; k++) {
+        int from = 1 + rand() % (size - 1), to = 1 + rand() % size;
+        bool is_target = false;
+        for (int i = 0; i < size; i++) {
+            is_target = is_target || board->jump_to[i] == from;
+        }
+        if (from != to && !is_target && board->jump_to[from - 1] == EMPTY &&
+            board->jump_to[to - 1] == EMPTY) {
+            board->jump_to[from - 1] = to;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * the function builds the chain of a board the way it was built before the
+ * dense arrays: every move is added with add_node_to_frequencies_list, once
+ * per unit of weight, finding the cells by linear lookups
+ * @param board
+ * @return the chain, NULL on failure
+ */
+static MarkovChain *build_reference_board(Board *board) {
+    MarkovChain *markov_chain = malloc(sizeof(MarkovChain));
+    LinkedList *database = malloc(sizeof(LinkedList));
+    if (markov_chain == NULL || database == NULL) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        free(markov_chain);
+        free(database);
+        return NULL;
+    }
+    initializing_board_chain(markov_chain, database);
+    markov_chain->hash = NULL;
+    bool success = true;
+    for (int i = 0; success && i < board->size; i++) {
+        int to = board->jump_to[i];
+        Cell cell = {i + 1, to > i + 1 ? to : EMPTY,
+                     to != EMPTY && to < i + 1 ? to : EMPTY,
+                     i + 1 == board->size};
+        success = add_to_database(markov_chain, &cell) != NULL;
+    }
+    for (int i = 0; success && i < board->size; i++) {
+        Cell cell = {i + 1, EMPTY, EMPTY, false}, next = cell;
+        MarkovNode *from_node = get_node_from_database(markov_chain,
+                                                       &cell)->data;
+        for (int j = 0; success && j < board->dice_max; j++) {
+            next.number = board->jump_to[i] != EMPTY ? board->jump_to[i] :
+                          i + j + 2;
+            int weight = board->jump_to[i] != EMPTY ? j == 0 :
+                         board->dice[j];
+            for (int w = 0; success && next.number <= board->size &&
+                            w < weight; w++) {
+                success = add_node_to_frequencies_list(
+                        from_node, get_node_from_database(
+                                markov_chain, &next)->data, markov_chain);
+            }
+        }
+    }
+    if (!success) {
+        free_database(&markov_chain);
+    }
+    return markov_chain;
+}
+
+/**
+ * the function checks that a frozen chain holds exactly the states and the
+ * frequencies lists of the chain it was frozen from, in the same order
+ * @param frozen
+ * @param markov_chain
+ * @return true if they match, else false
+ */
+static bool frozen_matches_chain(FrozenChain *frozen,
+                                 MarkovChain *markov_chain) {
+    if (frozen->num_states != markov_chain->database->size) {
+        return false;
+    }
+    for (Node *cur = markov_chain->database->first; cur; cur = cur->next) {
+        MarkovNode *node = cur->data;
+        FrozenState *state = &frozen->states[node->index];
+        if (state->data != node->data || state->num_edges !=
+                                         node->frequencies_list_len ||
+            state->is_last != markov_chain->is_last(node->data)) {
+            return false;
+        }
+        frequency_t cumulative = 0;
+        for (int j = 0; j < node->frequencies_list_len; j++) {
+            FrozenEdge *edge = &frozen->edges[state->first_edge + j];
+            cumulative += node->frequencies_list[j].frequency;
+            if (edge->to != node->frequencies_list[j].markov_node->index ||
+                edge->cumulative != cumulative) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * the function checks that the dense moves of a board are exactly the
+ * frequencies lists of its chain, in the same order
+ * @param dense
+ * @param nodes the states of the chain filled by fill_board_database, by
+ * index
+ * @return true if they match, else false
+ */
+static bool dense_matches_chain(DenseBoard *dense, MarkovNode **nodes) {
+    for (int i = 0; i < dense->size; i++) {
+        MarkovNode *node = nodes[i];
+        int first = dense->first[i];
+        if (dense->first[i + 1] - first != node->frequencies_list_len ||
+            dense->total[i] != node->frequencies_sum) {
+            return false;
+        }
+        for (int j = 0; j < node->frequencies_list_len; j++) {
+            if (dense->to[first + j] !=
+                node->frequencies_list[j].markov_node->index ||
+                dense->weight[first + j] !=
+                node->frequencies_list[j].frequency) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * the function checks if a state of a walker is last
+ * @param walker
+ * @param state index of the state
+ * @return true if the state is last, else false
+ */
+static bool is_last_state(Walker *walker, int state) {
+    if (walker->nodes != NULL) {
+        return walker->markov_chain->is_last(walker->nodes[state]->data);
+    }
+    if (walker->frozen != NULL) {
+        return walker->frozen->states[state].is_last;
+    }
+    return state == walker->dense->size - 1;
+}
+
+/**
+ * the function runs a random walk, like generate_tweet
+ * @param walker the chain to walk on
+ * @param state index of the first state
+ * @param length maximal length of the walk
+ * @param visited set to the indices of the visited states
+ * @return the number of visited states
+ */
+static int record_walk(Walker *walker, int state, int length, int *visited) {
+    int count = 0;
+    visited[count++] = state;
+    for (int i = 1; i < length; i++) {
+        if (walker->nodes != NULL) {
+            MarkovNode *next = get_next_random_node(walker->nodes[state]);
+            state = next == NULL ? -1 : next->index;
+        } else if (walker->frozen != NULL) {
+            state = get_next_frozen_state(walker->frozen, state);
+        } else {
+            state = get_next_dense_cell(walker->dense, state);
+        }
+        if (state == -1) { // no successors
+            break;
+        }
+        visited[count++] = state;
+        if (is_last_state(walker, state)) {
+            break;
+        }
+    }
+    return count;
+}
+
+/**
+ * the function checks that random walks with the same random numbers visit
+ * the same states on all walkers
+ * @param walkers the chains to walk on, of the same states
+ * @param num_walkers number of walkers
+ * @param size number of states
+ * @param from_first true to start every walk from the first state, else
+ * from random states
+ * @return true if all walks match, else false
+ */
+static bool walks_match(Walker *walkers, int num_walkers, int size,
+                        bool from_first) {
+    int visited[2][RANDOM_WALK_LENGTH];
+    bool match = true;
+    for (int w = 0; match && size > 0 && w < RANDOM_WALKS; w++) {
+        int start = from_first ? 0 : get_random_number(size);
+        unsigned int seed = (unsigned int) rand();
+        srand(seed);
+        int count = record_walk(&walkers[0], start, RANDOM_WALK_LENGTH,
+                                visited[0]);
+        for (int k = 1; match && k < num_walkers; k++) {
+            srand(seed);
+            match = record_walk(&walkers[k], start, RANDOM_WALK_LENGTH,
+                                visited[1]) == count &&
+                    memcmp(visited[0], visited[1], sizeof(int) * count) == 0;
+        }
+    }
+    return match;
+}
+
+/**
+ * the function checks the chains trained on a random corpus: by the tweets
+ * generator's trainer with linear and with hashed lookups, by the line
+ * trainer, and merged from halves must all be consistent and equal, the
+ * frozen chain must match the lists, walks on both must match and the
+ * sampled transitions of word corpora must follow the frequencies
+ * @param kind the kind of corpus
+ * @return true if all checks pass, else false
+ */
+static bool check_random_corpus(CorpusKind kind) {
+    static char *kind_names[NUM_CORPUS_KINDS] = {"words", "huge line",
+                                                 "no whitespace", "binary"};
+    size_t size;
+    char *corpus = generate_corpus(kind, &size);
+    FILE *fp = corpus ? fmemopen(corpus, size, "r") : NULL;
+    Lines lines = {NULL, NULL, NULL, 0, 0};
+    MarkovChain *chains[5] = {create_chain(), create_chain(), NULL, NULL,
+                              NULL};
+    MarkovChain *merged = NULL;
+    bool success = fp != NULL && chains[0] != NULL && chains[1] != NULL;
+    if (success) {
+        chains[0]->hash = NULL;
+        success = fill_word_database(fp, NO_WORDS, chains[0]) == 0;
+        rewind(fp);
+        success = success &&
+                  fill_word_database(fp, NO_WORDS, chains[1]) == 0;
+        rewind(fp);
+        success = success && read_lines(fp, &lines) == 0 &&
+                  (chains[2] = train_chain(&lines, 0, 1, hash_word)) &&
+                  (chains[3] = train_chain(&lines, 0, 2, hash_word)) &&
+                  (chains[4] = train_chain(&lines, 1, 2, hash_word)) &&
+                  (merged = merge_chains(chains + 3, NULL, 2)) != NULL;
+    }
+    bool equal = false;
+    if (success) {
+        equal = is_chain_consistent(chains[0]) &&
+                is_chain_consistent(chains[1]) &&
+                is_chain_consistent(merged) &&
+                chains_equal(chains[0], chains[1]) &&
+                chains_equal(chains[1], chains[2]) &&
+                chains_equal(chains[1], merged);
+    }
+    FrozenChain *frozen = NULL;
+    MarkovNode **nodes = NULL;
+    if (equal) {
+        success = (frozen = freeze_chain(chains[1], false)) != NULL &&
+                  (nodes = get_nodes(chains[1])) != NULL;
+        Walker walkers[2] = {{chains[1], nodes, NULL, NULL},
+                             {NULL, NULL, frozen, NULL}};
+        equal = success && frozen_matches_chain(frozen, chains[1]) &&
+                is_mapping_aligned(frozen) &&
+                walks_match(walkers, 2, chains[1]->database->size, false) &&
+                (kind != CORPUS_WORDS ||
+                 check_sampling(chains[1], RANDOM_SAMPLES));
+    }
+    if (!success) {
+        printf(ALLOCATION_ERROR_MASSAGE);
+    }
+    printf("Corpus of %s, %zu bytes, %d states: %s\n", kind_names[kind],
+           size, chains[1] ? chains[1]->database->size : 0,
+           equal ? "OK" : "MISMATCH");
+    if (frozen != NULL) {
+        free_frozen_chain(&frozen);
+    }
+    for (int i = 0; i < 5; i++) {
+        if (chains[i] != NULL) {
+            free_database(&chains[i]);
+        }
+    }
+    if (merged != NULL) {
+        free_database(&merged);
+    }
+    if (fp != NULL) {
+        fclose(fp);
+    }
+    free(nodes);
+    free_lines(&lines);
+    free(corpus);
+    return equal;
+}
+
+/**
+ * the function checks the builds of a random board: the chain built by
+ * fill_board_database from the dense arrays must equal the reference chain
+ * built by lookups, the dense arrays and the frozen chain must match its
+ * lists, and walks on the chain, the dense arrays and the frozen chain
+ * must match
+ * @return true if all checks pass, else false
+ */
+static bool check_random_board(void) {
+    Board board = {0, 0, NULL, NULL};
+    DenseBoard dense = {0, NULL, NULL, NULL, NULL};
+    MarkovChain *reference = NULL, *markov_chain = NULL;
+    LinkedList *database = NULL;
+    FrozenChain *frozen = NULL;
+    MarkovNode **nodes = NULL;
+    bool success = generate_board(&board) == EXIT_SUCCESS &&
+                   build_dense_board(&board, &dense) == EXIT_SUCCESS &&
+                   (reference = build_reference_board(&board)) != NULL &&
+                   (markov_chain = malloc(sizeof(MarkovChain))) != NULL &&
+                   (database = malloc(sizeof(LinkedList))) != NULL;
+    if (success) {
+        initializing_board_chain(markov_chain, database);
+        success = fill_board_database(markov_chain, &board, &dense) ==
+                  EXIT_SUCCESS &&
+                  (frozen = freeze_chain(markov_chain, false)) != NULL &&
+                  (nodes = get_nodes(markov_chain)) != NULL;
+    } else if (markov_chain != NULL) {
+        free(markov_chain);
+        markov_chain = NULL;
+    }
+    bool equal = false;
+    if (success) {
+        Walker walkers[3] = {{markov_chain, nodes, NULL, NULL},
+                             {NULL, NULL, NULL, &dense},
+                             {NULL, NULL, frozen, NULL}};
+        equal = is_chain_consistent(reference) &&
+                is_chain_consistent(markov_chain) &&
+                chains_equal(reference, markov_chain) &&
+                dense_matches_chain(&dense, nodes) &&
+                frozen_matches_chain(frozen, markov_chain) &&
+                is_mapping_aligned(frozen) &&
+                walks_match(walkers, 3, board.size, true);
+    }
+    printf("Board of %d cells, %d dice faces: %s\n", board.size,
+           board.dice_max, equal ? "OK" : "MISMATCH");
+    if (frozen != NULL) {
+        free_frozen_chain(&frozen);
+    }
+    if (markov_chain != NULL) {
+        free_database(&markov_chain);
+    }
+    if (reference != NULL) {
+        free_database(&reference);
+    }
+    free(nodes);
+    free_dense_board(&dense);
+    free_board(&board);
+    return equal;
+}
+
+/**
+ * the function checks the optimized paths against the reference ones on
+ * random corpora and boards. Round r uses the seed seed + r, so a failing
+ * round can be run alone with that seed and 1 round.
+ * @param argv 2) seed 3) number of rounds
+ * @return EXIT_SUCCESS if all rounds pass, else EXIT_FAILURE
+ */
+static int check_random(char *argv[]) {
+    char *endptr;
+    unsigned int seed = strtoul(argv[2], &endptr, BASE);
+    int rounds = strtol(argv[3], &endptr, BASE), failed = 0;
+    for (int r = 0; r < rounds; r++) {
+        srand(seed + r);
+        printf("Round %d (seed %u):\n", r + 1, seed + r);
+        bool corpus = check_random_corpus((seed + r) % NUM_CORPUS_KINDS);
+        bool board = check_random_board();
+        failed += !corpus || !board;
+    }
+    printf("Random rounds: %d of %d failed\n", failed, rounds);
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @param argc num of arguments
+ * @param argv 1) benchmark to run, followed by its arguments
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int main(int argc, char *argv[]) {
+    if (argc >= 2 && strcmp(argv[1], "score") == 0 &&
+        (argc == SCORE_ARGS || argc == SCORE_ARGS_SMOOTHING)) {
+        return bench_score(argc, argv);
+    }
+    if (argc == CHECK_ARGS && strcmp(argv[1], "check") == 0) {
+        return check(argv);
+    }
+    if ((argc == WALK_ARGS || argc == WALK_ARGS_THREADS) &&
+        strcmp(argv[1], "walk") == 0) {
+        return bench_walk(argc, argv);
+    }
+    if (argc == RANDOM_ARGS && strcmp(argv[1], "random") == 0) {
+        return check_random(argv);
+    }
+    printf("Usage: tweets_bench score <train file> <lines file> <threads> "
+           "[smoothing]\n"
+           "       tweets_bench check <file> <samples per state>\n"
+           "       tweets_bench walk <file> <walks> <max length> [threads]\n"
+           "       tweets_bench random <seed> <rounds>\n");
+    return EXIT_FAILURE;
+}
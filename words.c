@@ -0,0 +1,146 @@
+#define _POSIX_C_SOURCE 200809L // For getline()
+#include "words.h"
+#include <string.h> // For strlen(), strcmp(), strcpy(), strtok()
+
+/**
+ * as described in words.h
+ */
+void print_word(void *data) {
+    char *word = data;
+    printf("%s ", word);
+}
+
+/**
+ * as described in words.h
+ */
+bool check_if_last(void *data) {
+    char *word = data;
+    size_t len = strlen(word);
+    if (word[len - 1] == '.') { // Check the last character
+        return true;
+    }
+    return false;
+}
+
+/**
+ * as described in words.h
+ */
+int comp_chars(void *data1, void *data2) {
+    char *word1 = data1;
+    char *word2 = data2;
+    return strcmp(word1, word2);
+}
+
+/**
+ * as described in words.h
+ */
+void *copy_char(void *data) {
+    char *ptr_src = data;
+    char *word = malloc(strlen(ptr_src) + 1);
+    if (word == NULL) {
+        return NULL;
+    }
+    strcpy(word, ptr_src);
+    return word;
+}
+
+/**
+ * as described in words.h
+ */
+unsigned long hash_word(void *data) {
+    unsigned char *word = data;
+    unsigned long hash = 5381;
+    while (*word) {
+        hash = hash * 33 + *word++;
+    }
+    return hash;
+}
+
+/**
+ * as described in words.h
+ */
+void initializing_word_chain(MarkovChain *markov_chain, LinkedList *database) {
+    markov_chain->database = database;
+    markov_chain->database->first = NULL;
+    markov_chain->database->last = NULL;
+    markov_chain->database->size = 0;
+    markov_chain->print_func = print_word;
+    markov_chain->is_last = check_if_last;
+    markov_chain->free_data = free;
+    markov_chain->comp_func = comp_chars;
+    markov_chain->copy_func = copy_char;
+    markov_chain->hash = hash_word;
+    markov_chain->buckets = NULL;
+    markov_chain->num_buckets = 0;
+    markov_chain->decay = 1;
+    markov_chain->epoch = 0;
+}
+
+/**
+ * @param words_to_read number of lines to read
+ * @param num_words_read number of lines that has already been read
+ * @return 1 if the user gave no numbers to read, or there are words to read,
+ * but the amount of words to be read is smaller and we need
+ * to keep on reading! else 0
+ */
+static int got_num_words_to_read(int words_to_read, int num_words_read) {
+    if (words_to_read == NO_WORDS) {
+        return 1;
+    } else if (words_to_read > num_words_read) {
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * as described in words.h
+ */
+int fill_word_database(FILE *fp, int words_to_read,
+                       MarkovChain *markov_chain) {
+    int num_words_read = 0;
+    char *line = NULL;
+    size_t line_capacity = 0;
+    char *word;
+    while ((getline(&line, &line_capacity, fp) != -1) &&
+           (got_num_words_to_read(words_to_read, num_words_read))) {
+        word = strtok(line, " \n\r\t");
+        if (word != NULL) {
+            Node *first_node = add_to_database(markov_chain, word);
+            if (first_node != NULL) { //word added
+                num_words_read++;
+                word = strtok(NULL, " \n\r\t");
+            } else { //memory problem
+                free(line);
+                return 1;
+            }
+            if (words_to_read == num_words_read) {
+                break;
+            }
+            while ((word != NULL) &&
+                   (got_num_words_to_read(words_to_read, num_words_read))) {
+                Node *second_node = add_to_database(markov_chain, word);
+                if (second_node != NULL) { //word added
+                    num_words_read++;
+                    word = strtok(NULL, " \n\r\t");
+                } else { //memory problem
+                    free(line);
+                    return 1;
+                }
+                //updating frequencies list
+                if (!add_node_to_frequencies_list(first_node->data,
+                                                  second_node->data,
+                                                  markov_chain)) {
+                    free(line);
+                    return 1; //memory problem
+                }
+                //replacing first node and second node
+                first_node = second_node;
+            }
+        }
+        if (markov_chain->decay != 1) {
+            advance_epoch(markov_chain);
+        }
+    }
+    free(line);
+    return 0;
+}
@@ -0,0 +1,70 @@
+#ifndef _WORDS_H
+#define _WORDS_H
+
+#include "markov_chain.h"
+
+#define NO_WORDS -1
+
+/**
+ * Functions of a markov chain whose states are words, shared by the tweets
+ * generator, the tweets benchmark and the fuzz target.
+ */
+
+/**
+ * Print a word with space after it.
+ * @param data the given word
+ */
+void print_word(void *data);
+
+/**
+ * Check if the last char of a word is '.'
+ * @param data the word to check
+ * @return true if the last char is '.', else false
+ */
+bool check_if_last(void *data);
+
+/**
+ * Compare two words.
+ * @param data1 the first word
+ * @param data2 the second word
+ * @return 0 if the 2 words are equal, a positive value if the first is
+ * bigger, a negative value if the second is bigger
+ */
+int comp_chars(void *data1, void *data2);
+
+/**
+ * Copy and allocate the given word.
+ * @param data
+ * @return the new allocation of the copied word if the allocation succeeded,
+ * else NULL
+ */
+void *copy_char(void *data);
+
+/**
+ * Hash a word (djb2).
+ * @param data the word to hash
+ * @return the hash value of the word
+ */
+unsigned long hash_word(void *data);
+
+/**
+ * Initialize a new markov chain of words, with hashed lookups.
+ * @param markov_chain the new marko chain
+ * @param database the database to put in the chain
+ */
+void initializing_word_chain(MarkovChain *markov_chain, LinkedList *database);
+
+/**
+ * Fill the database of a chain of words from a file, with the transitions
+ * between consecutive words of every line. Words are separated by
+ * whitespace, lines may be of any length. If the chain decays, every line
+ * starts a new epoch, so later lines count more.
+ * @param fp a file
+ * @param words_to_read number of words to read, NO_WORDS for all
+ * @param markov_chain a pointer to a markov chain
+ * @return 0 if the database is filled successfully, else 1
+ */
+int fill_word_database(FILE *fp, int words_to_read,
+                       MarkovChain *markov_chain);
+
+#endif /* _WORDS_H */